@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/LogDecoder.dir/src/LogDecoder.cpp.o"
+  "CMakeFiles/LogDecoder.dir/src/LogDecoder.cpp.o.d"
+  "LogDecoder"
+  "LogDecoder.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/LogDecoder.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
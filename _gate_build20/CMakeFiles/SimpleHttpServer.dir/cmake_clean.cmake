@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/SimpleHttpServer.dir/src/Server.cpp.o"
+  "CMakeFiles/SimpleHttpServer.dir/src/Server.cpp.o.d"
+  "libSimpleHttpServer.pdb"
+  "libSimpleHttpServer.so"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/SimpleHttpServer.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/WebServerTest.dir/tests/http_server_test.cpp.o"
+  "CMakeFiles/WebServerTest.dir/tests/http_server_test.cpp.o.d"
+  "WebServerTest"
+  "WebServerTest.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/WebServerTest.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
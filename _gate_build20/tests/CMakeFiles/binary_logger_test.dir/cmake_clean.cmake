@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/binary_logger_test.dir/binary_logger_test.cpp.o"
+  "CMakeFiles/binary_logger_test.dir/binary_logger_test.cpp.o.d"
+  "binary_logger_test"
+  "binary_logger_test.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/binary_logger_test.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
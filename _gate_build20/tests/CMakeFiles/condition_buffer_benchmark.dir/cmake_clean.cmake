@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/condition_buffer_benchmark.dir/condition_buffer_benchmark.cpp.o"
+  "CMakeFiles/condition_buffer_benchmark.dir/condition_buffer_benchmark.cpp.o.d"
+  "condition_buffer_benchmark"
+  "condition_buffer_benchmark.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/condition_buffer_benchmark.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/condition_buffer_test.dir/condition_buffer_test.cpp.o"
+  "CMakeFiles/condition_buffer_test.dir/condition_buffer_test.cpp.o.d"
+  "condition_buffer_test"
+  "condition_buffer_test.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/condition_buffer_test.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
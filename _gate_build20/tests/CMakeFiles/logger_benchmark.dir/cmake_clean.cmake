@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/logger_benchmark.dir/logger_benchmark.cpp.o"
+  "CMakeFiles/logger_benchmark.dir/logger_benchmark.cpp.o.d"
+  "logger_benchmark"
+  "logger_benchmark.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/logger_benchmark.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
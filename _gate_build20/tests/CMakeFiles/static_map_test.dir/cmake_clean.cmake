@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/static_map_test.dir/static_map_test.cpp.o"
+  "CMakeFiles/static_map_test.dir/static_map_test.cpp.o.d"
+  "static_map_test"
+  "static_map_test.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/static_map_test.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
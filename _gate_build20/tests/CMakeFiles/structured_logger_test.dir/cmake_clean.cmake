@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/structured_logger_test.dir/structured_logger_test.cpp.o"
+  "CMakeFiles/structured_logger_test.dir/structured_logger_test.cpp.o.d"
+  "structured_logger_test"
+  "structured_logger_test.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/structured_logger_test.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
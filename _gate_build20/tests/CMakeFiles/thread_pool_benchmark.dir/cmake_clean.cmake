@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/thread_pool_benchmark.dir/thread_pool_benchmark.cpp.o"
+  "CMakeFiles/thread_pool_benchmark.dir/thread_pool_benchmark.cpp.o.d"
+  "thread_pool_benchmark"
+  "thread_pool_benchmark.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/thread_pool_benchmark.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
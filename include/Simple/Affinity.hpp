@@ -0,0 +1,228 @@
+#ifndef SIMPLE_AFFINITY_HPP
+#define SIMPLE_AFFINITY_HPP
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace Simple {
+
+/**
+ * @brief How threads of a pool are pinned to CPUs
+ */
+enum class Placement {
+    // threads are left to the scheduler
+    None,
+    // fill all CPUs of one NUMA node before moving to the next
+    Pack,
+    // take CPUs of all NUMA nodes in turn
+    Spread
+};
+
+/**
+ * @brief CPUs of every NUMA node of the machine
+ *
+ * Read from /sys/devices/system/node, machines without NUMA information
+ * show up as one node holding every CPU the process may run on.
+ */
+class NumaTopology {
+public:
+    static const NumaTopology& instance()
+    {
+        static NumaTopology topology = detect();
+        return topology;
+    }
+
+    static NumaTopology detect()
+    {
+        NumaTopology topology;
+        auto allowed = allowedCpus();
+        for (unsigned node = 0;; ++node) {
+            std::ifstream file{"/sys/devices/system/node/node" + std::to_string(node) + "/cpulist"};
+            if (!file)
+                break;
+            std::string list;
+            std::getline(file, list);
+
+            std::vector<unsigned> cpus;
+            for (auto cpu : parseCpuList(list)) {
+                if (std::find(allowed.begin(), allowed.end(), cpu) != allowed.end())
+                    cpus.push_back(cpu);
+            }
+            // nodes without usable CPUs keep their place so node numbers stay valid
+            topology.nodes.push_back(std::move(cpus));
+        }
+
+        if (topology.nodes.empty())
+            topology.nodes.push_back(allowed);
+
+        for (size_t node = 0; node < topology.nodes.size(); ++node) {
+            for (auto cpu : topology.nodes[node]) {
+                if (cpu >= topology.cpuNodes.size())
+                    topology.cpuNodes.resize(cpu + 1, 0);
+                topology.cpuNodes[cpu] = node;
+            }
+        }
+        return topology;
+    }
+
+    /**
+     * @brief Parse list in kernel format, e.g. "0-3,8,10-11"
+     */
+    static std::vector<unsigned> parseCpuList(const std::string& list)
+    {
+        std::vector<unsigned> cpus;
+        std::stringstream stream{list};
+        std::string range;
+        while (std::getline(stream, range, ',')) {
+            if (range.empty() || range.find_first_not_of(" \n") == std::string::npos)
+                continue;
+            auto dash = range.find('-');
+            unsigned first = static_cast<unsigned>(std::stoul(range.substr(0, dash)));
+            unsigned last = dash == std::string::npos ? first : static_cast<unsigned>(std::stoul(range.substr(dash + 1)));
+            for (unsigned cpu = first; cpu <= last; ++cpu) {
+                cpus.push_back(cpu);
+            }
+        }
+        return cpus;
+    }
+
+    /**
+     * @brief CPUs the calling process may run on
+     */
+    static std::vector<unsigned> allowedCpus()
+    {
+        std::vector<unsigned> cpus;
+#ifdef __linux__
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+            for (unsigned cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+                if (CPU_ISSET(cpu, &set))
+                    cpus.push_back(cpu);
+            }
+        }
+#endif
+        if (cpus.empty()) {
+            for (unsigned cpu = 0; cpu < std::max(std::thread::hardware_concurrency(), 1u); ++cpu) {
+                cpus.push_back(cpu);
+            }
+        }
+        return cpus;
+    }
+
+    size_t nodeCount() const
+    {
+        return nodes.size();
+    }
+
+    const std::vector<unsigned>& cpus(size_t node) const
+    {
+        return nodes[node];
+    }
+
+    /**
+     * @brief Node owning cpu, 0 when it is unknown
+     */
+    size_t nodeOf(unsigned cpu) const
+    {
+        return cpu < cpuNodes.size() ? cpuNodes[cpu] : 0;
+    }
+
+    /**
+     * @brief Node of the CPU the calling thread currently runs on
+     */
+    size_t currentNode() const
+    {
+#ifdef __linux__
+        int cpu = sched_getcpu();
+        if (cpu >= 0)
+            return nodeOf(static_cast<unsigned>(cpu));
+#endif
+        return 0;
+    }
+
+    /**
+     * @brief Order in which threads are assigned to CPUs
+     *
+     * Thread i goes to element i modulo size of the result. Non-empty
+     * allowed limits the result to the listed CPUs.
+     */
+    std::vector<unsigned> placementOrder(Placement placement, const std::vector<unsigned>& allowed = {}) const
+    {
+        std::vector<std::vector<unsigned>> usable;
+        for (auto& node : nodes) {
+            std::vector<unsigned> cpus;
+            for (auto cpu : node) {
+                if (allowed.empty() || std::find(allowed.begin(), allowed.end(), cpu) != allowed.end())
+                    cpus.push_back(cpu);
+            }
+            if (!cpus.empty())
+                usable.push_back(std::move(cpus));
+        }
+
+        std::vector<unsigned> order;
+        if (placement == Placement::Pack) {
+            for (auto& node : usable) {
+                order.insert(order.end(), node.begin(), node.end());
+            }
+        }
+        else if (placement == Placement::Spread) {
+            for (size_t i = 0; order.size() < countCpus(usable); ++i) {
+                for (auto& node : usable) {
+                    if (i < node.size())
+                        order.push_back(node[i]);
+                }
+            }
+        }
+
+        // CPUs unknown to the topology are still honoured
+        if (order.empty() && placement != Placement::None)
+            order = allowed;
+        return order;
+    }
+
+private:
+    static size_t countCpus(const std::vector<std::vector<unsigned>>& nodes)
+    {
+        size_t count = 0;
+        for (auto& node : nodes) {
+            count += node.size();
+        }
+        return count;
+    }
+
+    std::vector<std::vector<unsigned>> nodes;
+    std::vector<size_t> cpuNodes;
+};
+
+/**
+ * @brief Restrict calling thread to single CPU
+ *
+ * @return false when the CPU is not available or platform lacks affinity support
+ */
+inline bool pinCurrentThread(unsigned cpu)
+{
+#ifdef __linux__
+    if (cpu >= CPU_SETSIZE)
+        return false;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    (void)cpu;
+    return false;
+#endif
+}
+} // namespace Simple
+
+#endif /* ifndef SIMPLE_AFFINITY_HPP */
@@ -0,0 +1,959 @@
+#ifndef SIMPLE_BINARY_LOGGER_HPP
+#define SIMPLE_BINARY_LOGGER_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "Logger.hpp"
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define SIMPLE_BINARY_LOGGER_RDTSC
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#define SIMPLE_BINARY_LOGGER_RDTSC
+#endif
+
+namespace Simple {
+
+/**
+ * @brief Type of an argument as it is stored in a binary log
+ */
+enum class BinaryArg : std::uint8_t {
+    Bool,
+    Char,
+    Int8,
+    Int16,
+    Int32,
+    Int64,
+    UInt8,
+    UInt16,
+    UInt32,
+    UInt64,
+    Float,
+    Double,
+    // length as uint32 followed by the characters
+    String
+};
+
+/**
+ * @brief Everything known about a LOG_BINARY call site, written to the log once
+ */
+struct BinaryLogSite {
+    int level = LogLevel::Info;
+    std::string file;
+    std::uint32_t line = 0;
+    // "{}" stands for the next argument
+    std::string format;
+    std::vector<BinaryArg> args;
+};
+
+namespace detail {
+
+// "SLOGBIN" and the format version, values are stored in the byte order of the writing machine
+constexpr char BinaryMagic[8] = {'S', 'L', 'O', 'G', 'B', 'I', 'N', '1'};
+constexpr char BinarySiteTag = 'S';
+constexpr char BinaryRecordTag = 'R';
+// ticks and wall clock nanoseconds read together, the reader converts the ticks of records with them
+constexpr char BinaryCalibrationTag = 'C';
+// tag, site id and ticks
+constexpr std::size_t BinaryRecordHeader = 1 + sizeof(std::uint32_t) + sizeof(std::uint64_t);
+// longer strings are cut, a record always fits into a ring
+constexpr std::size_t MaxBinaryString = 1024;
+
+// time of a record, far cheaper to read than the wall clock
+inline std::uint64_t binaryTicks()
+{
+#ifdef SIMPLE_BINARY_LOGGER_RDTSC
+    return __rdtsc();
+#else
+    return static_cast<std::uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+}
+
+inline std::uint64_t wallClockNanoseconds()
+{
+    return static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch())
+            .count());
+}
+
+template <class... Args>
+struct BinaryArgs {
+};
+
+// only named in decltype, the macro must not evaluate the arguments twice
+template <class... Args>
+BinaryArgs<std::decay_t<Args>...> binaryArgs(const Args&...);
+
+template <class T>
+struct AlwaysFalse : std::false_type {
+};
+
+template <class T>
+constexpr BinaryArg binaryArgOf()
+{
+    if constexpr (std::is_same_v<T, bool>)
+        return BinaryArg::Bool;
+    else if constexpr (std::is_same_v<T, char>)
+        return BinaryArg::Char;
+    else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>)
+        return sizeof(T) == 1   ? BinaryArg::Int8
+               : sizeof(T) == 2 ? BinaryArg::Int16
+               : sizeof(T) == 4 ? BinaryArg::Int32
+                                : BinaryArg::Int64;
+    else if constexpr (std::is_integral_v<T>)
+        return sizeof(T) == 1   ? BinaryArg::UInt8
+               : sizeof(T) == 2 ? BinaryArg::UInt16
+               : sizeof(T) == 4 ? BinaryArg::UInt32
+                                : BinaryArg::UInt64;
+    else if constexpr (std::is_same_v<T, float>)
+        return BinaryArg::Float;
+    else if constexpr (std::is_floating_point_v<T>)
+        return BinaryArg::Double;
+    else if constexpr (std::is_convertible_v<T, std::string_view>)
+        return BinaryArg::String;
+    else
+        static_assert(AlwaysFalse<T>::value, "LOG_BINARY takes numbers, characters and strings only");
+}
+
+inline std::size_t binaryArgSize(BinaryArg arg)
+{
+    switch (arg) {
+    case BinaryArg::Bool:
+    case BinaryArg::Char:
+    case BinaryArg::Int8:
+    case BinaryArg::UInt8:
+        return 1;
+    case BinaryArg::Int16:
+    case BinaryArg::UInt16:
+        return 2;
+    case BinaryArg::Int32:
+    case BinaryArg::UInt32:
+    case BinaryArg::Float:
+        return 4;
+    case BinaryArg::Int64:
+    case BinaryArg::UInt64:
+    case BinaryArg::Double:
+        return 8;
+    case BinaryArg::String:
+        return sizeof(std::uint32_t);
+    }
+    return 0;
+}
+
+inline std::string_view binaryString(std::string_view text)
+{
+    return text.substr(0, MaxBinaryString);
+}
+
+inline std::string_view binaryString(const char* text)
+{
+    return binaryString(std::string_view(text == nullptr ? "(null)" : text));
+}
+
+// bytes an argument takes in a record
+template <class T>
+std::size_t encodedSize(const T& value)
+{
+    constexpr BinaryArg arg = binaryArgOf<std::decay_t<T>>();
+    if constexpr (arg == BinaryArg::String)
+        return sizeof(std::uint32_t) + binaryString(value).size();
+    else
+        return binaryArgSize(arg);
+}
+
+// largest record of a call site, the room needed to encode it off the ring
+template <class... Args>
+constexpr std::size_t maxRecordSize()
+{
+    return BinaryRecordHeader
+           + (std::size_t(0) + ...
+              + (binaryArgOf<Args>() == BinaryArg::String ? sizeof(std::uint32_t) + MaxBinaryString : sizeof(Args)));
+}
+
+template <class T>
+char* encodeRaw(char* out, const T& value)
+{
+    std::memcpy(out, &value, sizeof(T));
+    return out + sizeof(T);
+}
+
+template <class T>
+char* encodeArg(char* out, const T& value)
+{
+    constexpr BinaryArg arg = binaryArgOf<std::decay_t<T>>();
+    if constexpr (arg == BinaryArg::String) {
+        auto text = binaryString(value);
+        out = encodeRaw(out, static_cast<std::uint32_t>(text.size()));
+        std::memcpy(out, text.data(), text.size());
+        return out + text.size();
+    }
+    else if constexpr (arg == BinaryArg::Double) {
+        return encodeRaw(out, static_cast<double>(value));
+    }
+    else {
+        return encodeRaw(out, value);
+    }
+}
+
+template <class... Args>
+void encodeRecord(char* out, std::uint32_t site, std::uint64_t ticks, const Args&... args)
+{
+    *out++ = BinaryRecordTag;
+    out = encodeRaw(out, site);
+    out = encodeRaw(out, ticks);
+    ((out = encodeArg(out, args)), ...);
+}
+
+template <class T>
+T decodeRaw(const char*& in)
+{
+    T value;
+    std::memcpy(&value, in, sizeof(T));
+    in += sizeof(T);
+    return value;
+}
+
+// the time prefix Logger writes on Linux, for any point in time
+inline std::size_t formatTimestamp(char* buffer, std::uint64_t timestamp)
+{
+    time_t seconds = static_cast<time_t>(timestamp / 1000000000);
+    tm local;
+#ifdef WIN32
+    localtime_s(&local, &seconds);
+#else
+    localtime_r(&seconds, &local);
+#endif
+    std::size_t length = strftime(buffer, 32, "%Y-%m-%d %H:%M:%S", &local);
+    appendMilliseconds(buffer, length, static_cast<long>(timestamp / 1000000 % 1000));
+    return length;
+}
+
+inline void appendArg(LogBuffer& line, BinaryArg arg, const char*& in)
+{
+    char digits[64];
+    char* end = digits + IntegerDigits;
+    switch (arg) {
+    case BinaryArg::Bool:
+        line.append(decodeRaw<bool>(in) ? '1' : '0');
+        return;
+    case BinaryArg::Char:
+        line.append(decodeRaw<char>(in));
+        return;
+    case BinaryArg::Int8:
+    case BinaryArg::Int16:
+    case BinaryArg::Int32:
+    case BinaryArg::Int64: {
+        long long value = arg == BinaryArg::Int8    ? decodeRaw<std::int8_t>(in)
+                          : arg == BinaryArg::Int16 ? decodeRaw<std::int16_t>(in)
+                          : arg == BinaryArg::Int32 ? decodeRaw<std::int32_t>(in)
+                                                    : decodeRaw<std::int64_t>(in);
+        char* begin = formatInteger(end, value, std::true_type());
+        line.append(begin, static_cast<std::size_t>(end - begin));
+        return;
+    }
+    case BinaryArg::UInt8:
+    case BinaryArg::UInt16:
+    case BinaryArg::UInt32:
+    case BinaryArg::UInt64: {
+        unsigned long long value = arg == BinaryArg::UInt8    ? decodeRaw<std::uint8_t>(in)
+                                   : arg == BinaryArg::UInt16 ? decodeRaw<std::uint16_t>(in)
+                                   : arg == BinaryArg::UInt32 ? decodeRaw<std::uint32_t>(in)
+                                                              : decodeRaw<std::uint64_t>(in);
+        char* begin = formatInteger(end, value, std::false_type());
+        line.append(begin, static_cast<std::size_t>(end - begin));
+        return;
+    }
+    case BinaryArg::Float:
+        line.append(digits, formatFloating(digits, sizeof(digits), decodeRaw<float>(in)));
+        return;
+    case BinaryArg::Double:
+        line.append(digits, formatFloating(digits, sizeof(digits), decodeRaw<double>(in)));
+        return;
+    case BinaryArg::String: {
+        auto length = decodeRaw<std::uint32_t>(in);
+        line.append(in, length);
+        in += length;
+        return;
+    }
+    }
+}
+
+// the text line of a record, in reads the arguments and is left behind them
+inline void formatRecord(const BinaryLogSite& site, std::uint64_t timestamp, const char*& in, LogBuffer& line)
+{
+    char time[32];
+    line.append(time, formatTimestamp(time, timestamp));
+    const char* prefix = levelPrefix(site.level);
+    line.append(prefix, std::strlen(prefix));
+
+    std::string_view format = site.format;
+    std::size_t next = 0;
+    for (BinaryArg arg : site.args) {
+        auto placeholder = format.find("{}", next);
+        if (placeholder == std::string_view::npos) {
+            // more arguments than placeholders, they follow the text
+            line.append(format.data() + next, format.size() - next);
+            line.append(' ');
+            next = format.size();
+        }
+        else {
+            line.append(format.data() + next, placeholder - next);
+            next = placeholder + 2;
+        }
+        appendArg(line, arg, in);
+    }
+    line.append(format.data() + next, format.size() - next);
+}
+
+/**
+ * @brief Bytes of one thread's records on their way to the writer thread
+ *
+ * Single producer, single consumer. The producer waits for the consumer when
+ * the ring is full, no record is lost while the consumer runs.
+ */
+class BinaryRing {
+public:
+    static constexpr std::size_t Size = 1 << 18;
+
+    BinaryRing()
+        : data(new char[Size])
+    {
+    }
+
+    // producer side
+
+    // false when stopped() tells that no consumer is left to make room
+    template <class Wake, class Stopped>
+    bool waitForSpace(std::size_t size, Wake&& wake, Stopped&& stopped)
+    {
+        auto position = head.load(std::memory_order_relaxed);
+        if (position + size - cachedTail <= Size)
+            return true;
+        cachedTail = tail.load(std::memory_order_acquire);
+        while (position + size - cachedTail > Size) {
+            if (stopped())
+                return false;
+            wake();
+            std::this_thread::yield();
+            cachedTail = tail.load(std::memory_order_acquire);
+        }
+        return true;
+    }
+
+    // where a record of size bytes goes, nullptr when it would wrap around the end
+    char* contiguous(std::size_t size)
+    {
+        auto offset = head.load(std::memory_order_relaxed) & (Size - 1);
+        return offset + size <= Size ? data.get() + offset : nullptr;
+    }
+
+    void copyIn(const char* bytes, std::size_t size)
+    {
+        auto offset = head.load(std::memory_order_relaxed) & (Size - 1);
+        auto first = std::min(size, Size - offset);
+        std::memcpy(data.get() + offset, bytes, first);
+        std::memcpy(data.get(), bytes + first, size - first);
+    }
+
+    void commit(std::size_t size)
+    {
+        head.store(head.load(std::memory_order_relaxed) + size, std::memory_order_release);
+    }
+
+    void retire()
+    {
+        retired.store(true, std::memory_order_release);
+    }
+
+    // consumer side
+
+    std::uint64_t published() const
+    {
+        return head.load(std::memory_order_acquire);
+    }
+
+    bool isRetired() const
+    {
+        return retired.load(std::memory_order_acquire);
+    }
+
+    bool empty() const
+    {
+        return tail.load(std::memory_order_relaxed) == head.load(std::memory_order_acquire);
+    }
+
+    // hands bytes up to end to sink in at most two pieces and frees them
+    template <class Sink>
+    std::size_t drain(std::uint64_t end, Sink&& sink)
+    {
+        auto begin = tail.load(std::memory_order_relaxed);
+        if (begin == end)
+            return 0;
+        auto size = static_cast<std::size_t>(end - begin);
+        auto offset = begin & (Size - 1);
+        auto first = std::min(size, Size - offset);
+        sink(data.get() + offset, first);
+        if (first < size)
+            sink(data.get(), size - first);
+        tail.store(end, std::memory_order_release);
+        return size;
+    }
+
+private:
+    std::unique_ptr<char[]> data;
+    alignas(64) std::atomic<std::uint64_t> head{0};
+    std::uint64_t cachedTail = 0;
+    alignas(64) std::atomic<std::uint64_t> tail{0};
+    std::atomic_bool retired{false};
+};
+
+} // namespace detail
+
+/**
+ * @brief Deferred logging for the hottest trace points
+ *
+ * A call site registers its level, location, format and argument types once.
+ * Every call then copies only a timestamp and the raw arguments into a ring
+ * of the calling thread. A writer thread moves the rings into the file, and
+ * LogDecoder or BinaryLogReader turn it back into the text Logger writes.
+ * While no file is open, lines are formatted and handed to Logger right away.
+ */
+class BinaryLogger {
+public:
+    static BinaryLogger* getInstance()
+    {
+        static BinaryLogger instance;
+        return &instance;
+    }
+
+    /**
+     * @brief Start writing records to path, truncating it
+     */
+    void open(const std::string& path)
+    {
+        std::lock_guard<std::mutex> openLock{openMtx};
+        stopWriter();
+
+        file.open(path, std::ios::binary | std::ios::trunc);
+        if (!file)
+            throw std::runtime_error("Cannot open binary log file: " + path);
+        file.write(detail::BinaryMagic, sizeof(detail::BinaryMagic));
+        writeCalibration();
+        {
+            std::lock_guard<std::mutex> lock{siteMtx};
+            sitesWritten = 0;
+        }
+        {
+            std::lock_guard<std::mutex> lock{mtx};
+            stopping = false;
+            running = true;
+        }
+        writer = std::thread([this]() { writeLoop(); });
+        opened.store(true, std::memory_order_release);
+    }
+
+    /**
+     * @brief Write everything logged so far and close the file
+     *
+     * Records logged concurrently with the call may stay behind for the next file.
+     */
+    void close()
+    {
+        std::lock_guard<std::mutex> openLock{openMtx};
+        stopWriter();
+    }
+
+    /**
+     * @brief Wait until every record logged before the call is in the file
+     */
+    void flush()
+    {
+        std::unique_lock<std::mutex> lock{mtx};
+        if (!running)
+            return;
+        auto target = passesBegun + 1;
+        flushRequested = true;
+        wakeCv.notify_one();
+        doneCv.wait(lock, [&]() { return passesDone >= target || !running; });
+    }
+
+    bool isOpen() const
+    {
+        return opened.load(std::memory_order_acquire);
+    }
+
+    template <class... Args>
+    std::uint32_t registerSite(int level, const char* format, const char* file, int line, detail::BinaryArgs<Args...>)
+    {
+        BinaryLogSite site;
+        site.level = level;
+        site.file = file;
+        site.line = static_cast<std::uint32_t>(line);
+        site.format = format;
+        site.args = {detail::binaryArgOf<Args>()...};
+
+        std::lock_guard<std::mutex> lock{siteMtx};
+        sites.push_back(std::move(site));
+        return static_cast<std::uint32_t>(sites.size() - 1);
+    }
+
+    template <class... Args>
+    void write(std::uint32_t site, const Args&... args)
+    {
+        if (!opened.load(std::memory_order_acquire)) {
+            writeText(site, detail::wallClockNanoseconds(), args...);
+            return;
+        }
+        auto ticks = detail::binaryTicks();
+
+        auto size = detail::BinaryRecordHeader + (std::size_t(0) + ... + detail::encodedSize(args));
+        auto& ring = threadRing();
+        // the file was closed while the ring is full, the record is formatted like without a file
+        if (!ring.waitForSpace(size, [this]() { wakeCv.notify_one(); },
+                               [this]() { return !opened.load(std::memory_order_acquire); })) {
+            writeText(site, detail::wallClockNanoseconds(), args...);
+            return;
+        }
+        if (char* out = ring.contiguous(size)) {
+            detail::encodeRecord(out, site, ticks, args...);
+        }
+        else {
+            char record[detail::maxRecordSize<std::decay_t<Args>...>()];
+            detail::encodeRecord(record, site, ticks, args...);
+            ring.copyIn(record, size);
+        }
+        ring.commit(size);
+    }
+
+private:
+    // how long the writer sleeps when every ring was empty
+    static constexpr std::chrono::milliseconds PollInterval{1};
+    // calibration points follow the first one after FirstCalibration and then every CalibrationInterval,
+    // the reader interpolates between them
+    static constexpr std::chrono::milliseconds FirstCalibration{10};
+    static constexpr std::chrono::milliseconds CalibrationInterval{1000};
+
+    BinaryLogger() = default;
+    BinaryLogger(const BinaryLogger&) = delete;
+    BinaryLogger& operator=(const BinaryLogger&) = delete;
+
+    ~BinaryLogger()
+    {
+        close();
+    }
+
+    // a thread's ring outlives the thread until the writer emptied it
+    struct RingHandle {
+        std::shared_ptr<detail::BinaryRing> ring;
+
+        ~RingHandle()
+        {
+            if (ring)
+                ring->retire();
+        }
+    };
+
+    detail::BinaryRing& threadRing()
+    {
+        static thread_local RingHandle handle;
+        if (!handle.ring) {
+            handle.ring = std::make_shared<detail::BinaryRing>();
+            std::lock_guard<std::mutex> lock{ringsMtx};
+            rings.push_back(handle.ring);
+        }
+        return *handle.ring;
+    }
+
+    template <class... Args>
+    void writeText(std::uint32_t site, std::uint64_t timestamp, const Args&... args)
+    {
+        char record[detail::maxRecordSize<std::decay_t<Args>...>()];
+        detail::encodeRecord(record, site, timestamp, args...);
+        const char* in = record + detail::BinaryRecordHeader;
+        LogBuffer line;
+        {
+            std::lock_guard<std::mutex> lock{siteMtx};
+            detail::formatRecord(sites[site], timestamp, in, line);
+        }
+        Logger::getInstance()->writeStream(std::move(line));
+    }
+
+    void stopWriter()
+    {
+        opened.store(false, std::memory_order_release);
+        if (!writer.joinable())
+            return;
+        {
+            std::lock_guard<std::mutex> lock{mtx};
+            stopping = true;
+        }
+        wakeCv.notify_one();
+        writer.join();
+        file.close();
+        {
+            std::lock_guard<std::mutex> lock{mtx};
+            running = false;
+        }
+        doneCv.notify_all();
+    }
+
+    void writeLoop()
+    {
+        bool busy = false;
+        auto nextCalibration = std::chrono::steady_clock::now() + FirstCalibration;
+        while (true) {
+            std::uint64_t pass;
+            bool flushing;
+            bool stop;
+            {
+                std::unique_lock<std::mutex> lock{mtx};
+                if (!busy)
+                    wakeCv.wait_for(lock, PollInterval, [this]() { return stopping || flushRequested; });
+                pass = ++passesBegun;
+                flushing = flushRequested;
+                flushRequested = false;
+                stop = stopping;
+            }
+
+            busy = writePass();
+            if (stop || std::chrono::steady_clock::now() >= nextCalibration) {
+                writeCalibration();
+                nextCalibration = std::chrono::steady_clock::now() + CalibrationInterval;
+            }
+            if (flushing || stop || !busy)
+                file.flush();
+
+            {
+                std::lock_guard<std::mutex> lock{mtx};
+                passesDone = pass;
+            }
+            doneCv.notify_all();
+            if (stop)
+                break;
+        }
+    }
+
+    // returns whether any record was written
+    bool writePass()
+    {
+        struct Pending {
+            std::shared_ptr<detail::BinaryRing> ring;
+            bool retired;
+            std::uint64_t end;
+        };
+        std::vector<Pending> pending;
+        {
+            std::lock_guard<std::mutex> lock{ringsMtx};
+            pending.reserve(rings.size());
+            for (auto& ring : rings) {
+                // retired first, then the last records of the thread are published too
+                bool retired = ring->isRetired();
+                pending.push_back({ring, retired, ring->published()});
+            }
+        }
+
+        // the sites of the records taken above were registered before them
+        writeSites();
+
+        std::size_t written = 0;
+        for (auto& entry : pending) {
+            written += entry.ring->drain(entry.end, [this](const char* bytes, std::size_t size) {
+                file.write(bytes, static_cast<std::streamsize>(size));
+            });
+        }
+
+        std::lock_guard<std::mutex> lock{ringsMtx};
+        rings.erase(std::remove_if(rings.begin(), rings.end(),
+                                   [](const std::shared_ptr<detail::BinaryRing>& ring) {
+                                       return ring->isRetired() && ring->empty();
+                                   }),
+                    rings.end());
+        return written > 0;
+    }
+
+    void writeSites()
+    {
+        std::lock_guard<std::mutex> lock{siteMtx};
+        for (; sitesWritten < sites.size(); ++sitesWritten) {
+            const auto& site = sites[sitesWritten];
+            file.put(detail::BinarySiteTag);
+            writeRaw(static_cast<std::uint32_t>(sitesWritten));
+            writeRaw(static_cast<std::int32_t>(site.level));
+            writeRaw(site.line);
+            writeRaw(static_cast<std::uint32_t>(site.args.size()));
+            file.write(reinterpret_cast<const char*>(site.args.data()), static_cast<std::streamsize>(site.args.size()));
+            writeRaw(static_cast<std::uint32_t>(site.file.size()));
+            file.write(site.file.data(), static_cast<std::streamsize>(site.file.size()));
+            writeRaw(static_cast<std::uint32_t>(site.format.size()));
+            file.write(site.format.data(), static_cast<std::streamsize>(site.format.size()));
+        }
+    }
+
+    void writeCalibration()
+    {
+        auto ticks = detail::binaryTicks();
+        auto wallClock = detail::wallClockNanoseconds();
+        file.put(detail::BinaryCalibrationTag);
+        writeRaw(ticks);
+        writeRaw(wallClock);
+    }
+
+    template <class T>
+    void writeRaw(const T& value)
+    {
+        file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    std::atomic_bool opened{false};
+    std::mutex openMtx;
+    std::thread writer;
+    std::ofstream file;
+
+    std::mutex mtx;
+    std::condition_variable wakeCv;
+    std::condition_variable doneCv;
+    bool running = false;
+    bool stopping = false;
+    bool flushRequested = false;
+    std::uint64_t passesBegun = 0;
+    std::uint64_t passesDone = 0;
+
+    std::mutex siteMtx;
+    std::deque<BinaryLogSite> sites;
+    std::size_t sitesWritten = 0;
+
+    std::mutex ringsMtx;
+    std::vector<std::shared_ptr<detail::BinaryRing>> rings;
+};
+
+/**
+ * @brief Reads a file written by BinaryLogger back as Logger text lines
+ */
+class BinaryLogReader {
+public:
+    explicit BinaryLogReader(const std::string& path)
+    {
+        std::ifstream file{path, std::ios::binary};
+        if (!file)
+            throw std::runtime_error("Cannot open binary log file: " + path);
+        bytes.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        if (bytes.size() < sizeof(detail::BinaryMagic)
+            || std::memcmp(bytes.data(), detail::BinaryMagic, sizeof(detail::BinaryMagic)) != 0)
+            throw std::runtime_error("Not a binary log file: " + path);
+
+        // records are converted with calibration points written after them
+        position = sizeof(detail::BinaryMagic);
+        while (readEntry(nullptr) != Entry::End) {
+        }
+        position = sizeof(detail::BinaryMagic);
+    }
+
+    /**
+     * @brief Format the next record into line, false at the end of the file
+     *
+     * A record cut off by a crash of the writing process ends the file.
+     */
+    bool next(LogBuffer& line)
+    {
+        while (true) {
+            switch (readEntry(&line)) {
+            case Entry::End:
+                return false;
+            case Entry::Record:
+                return true;
+            default:
+                break;
+            }
+        }
+    }
+
+    const std::vector<BinaryLogSite>& logSites() const
+    {
+        return sites;
+    }
+
+private:
+    enum class Entry { End, Site, Calibration, Record };
+
+    struct Calibration {
+        std::uint64_t ticks;
+        std::uint64_t wallClock;
+    };
+
+    Entry readEntry(LogBuffer* line)
+    {
+        if (position >= bytes.size())
+            return Entry::End;
+        char tag = bytes[position++];
+        switch (tag) {
+        case detail::BinarySiteTag:
+            return readSite() ? Entry::Site : Entry::End;
+        case detail::BinaryCalibrationTag:
+            return readCalibration(line == nullptr) ? Entry::Calibration : Entry::End;
+        case detail::BinaryRecordTag:
+            return readRecord(line) ? Entry::Record : Entry::End;
+        default:
+            throw std::runtime_error("Corrupt binary log file.");
+        }
+    }
+
+    bool available(std::size_t size) const
+    {
+        return bytes.size() - position >= size;
+    }
+
+    template <class T>
+    bool read(T& value)
+    {
+        if (!available(sizeof(T)))
+            return false;
+        const char* in = bytes.data() + position;
+        value = detail::decodeRaw<T>(in);
+        position += sizeof(T);
+        return true;
+    }
+
+    bool readText(std::string& text)
+    {
+        std::uint32_t size;
+        if (!read(size) || !available(size))
+            return false;
+        text.assign(bytes.data() + position, size);
+        position += size;
+        return true;
+    }
+
+    bool readSite()
+    {
+        std::uint32_t id;
+        std::int32_t level;
+        std::uint32_t argCount;
+        BinaryLogSite site;
+        if (!read(id) || !read(level) || !read(site.line) || !read(argCount) || !available(argCount))
+            return false;
+        site.level = level;
+        for (std::uint32_t i = 0; i < argCount; ++i) {
+            site.args.push_back(static_cast<BinaryArg>(bytes[position++]));
+        }
+        if (!readText(site.file) || !readText(site.format))
+            return false;
+        if (id >= sites.size())
+            sites.resize(id + 1);
+        sites[id] = std::move(site);
+        return true;
+    }
+
+    bool readCalibration(bool collect)
+    {
+        Calibration calibration;
+        if (!read(calibration.ticks) || !read(calibration.wallClock))
+            return false;
+        if (collect)
+            calibrations.push_back(calibration);
+        return true;
+    }
+
+    // without a line the record is only skipped
+    bool readRecord(LogBuffer* line)
+    {
+        std::uint32_t id;
+        std::uint64_t ticks;
+        if (!read(id) || !read(ticks))
+            return false;
+        if (id >= sites.size())
+            throw std::runtime_error("Corrupt binary log file, record of unknown call site.");
+        const auto& site = sites[id];
+
+        // every argument is complete before any gets formatted
+        auto end = position;
+        for (BinaryArg arg : site.args) {
+            auto size = detail::binaryArgSize(arg);
+            if (bytes.size() - end < size)
+                return false;
+            if (arg == BinaryArg::String) {
+                std::uint32_t length;
+                std::memcpy(&length, bytes.data() + end, sizeof(length));
+                size += length;
+                if (bytes.size() - end < size)
+                    return false;
+            }
+            end += size;
+        }
+
+        if (line != nullptr) {
+            const char* in = bytes.data() + position;
+            line->clear();
+            detail::formatRecord(site, wallClock(ticks), in, *line);
+        }
+        position = end;
+        return true;
+    }
+
+    // interpolated between the calibration points around ticks, extrapolated beyond the first and last
+    std::uint64_t wallClock(std::uint64_t ticks) const
+    {
+        if (calibrations.empty())
+            return 0;
+        if (calibrations.size() == 1) {
+            // no rate known, the process died right after opening the file
+            return calibrations[0].wallClock;
+        }
+        auto after = std::upper_bound(calibrations.begin(), calibrations.end(), ticks,
+                                      [](std::uint64_t value, const Calibration& c) { return value < c.ticks; });
+        if (after == calibrations.begin())
+            ++after;
+        if (after == calibrations.end())
+            --after;
+        const auto& a = *(after - 1);
+        const auto& b = *after;
+        double rate = static_cast<double>(b.wallClock - a.wallClock) / static_cast<double>(b.ticks - a.ticks);
+        double offset = static_cast<double>(static_cast<std::int64_t>(ticks - a.ticks)) * rate;
+        return static_cast<std::uint64_t>(static_cast<std::int64_t>(a.wallClock) + static_cast<std::int64_t>(offset));
+    }
+
+    std::string bytes;
+    std::size_t position = 0;
+    std::vector<BinaryLogSite> sites;
+    std::vector<Calibration> calibrations;
+};
+
+} // namespace Simple
+
+/**
+ * LOG_BINARY(level, "format with {} placeholders", args...)
+ *
+ * The level is filtered like LOG(level). Numbers, characters and strings can be logged.
+ */
+#define LOG_BINARY(level, format, ...)                                                                                 \
+    do {                                                                                                               \
+        if (level <= SIMPLE_LOGGER_MAX_LEVEL && level <= Simple::Logger::currentLevel()) {                             \
+            static const std::uint32_t simpleBinarySite = Simple::BinaryLogger::getInstance()->registerSite(           \
+                level, format, __FILE__, __LINE__, decltype(Simple::detail::binaryArgs(__VA_ARGS__)){});               \
+            Simple::BinaryLogger::getInstance()->write(simpleBinarySite, ##__VA_ARGS__);                               \
+        }                                                                                                              \
+    } while (0)
+
+#define LOG_BINARY_INFO(...) LOG_BINARY(Simple::LogLevel::Info, __VA_ARGS__)
+
+#define LOG_BINARY_DEBUG(...) LOG_BINARY(Simple::LogLevel::Debug, __VA_ARGS__)
+
+#define LOG_BINARY_TRACE(...) LOG_BINARY(Simple::LogLevel::Trace, __VA_ARGS__)
+
+#endif // SIMPLE_BINARY_LOGGER_HPP
@@ -1,22 +1,148 @@
 #ifndef SIMPLE_CONDITION_BUFFER_HPP
 #define SIMPLE_CONDITION_BUFFER_HPP
 
+#include <algorithm>
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <iterator>
 #include <mutex>
+#include <new>
 #include <queue>
+#include <thread>
 
 namespace Simple {
-template <typename T, size_t size>
+
+/**
+ * @brief Synchronisation strategy of ConditionBuffer
+ */
+enum class BufferPolicy {
+    // std::queue under a mutex, any number of producers and consumers
+    Locked,
+    // lock-free ring, exactly one producer and one consumer thread
+    Spsc,
+    // lock-free ring, any number of producers and consumers
+    Mpmc
+};
+
+namespace detail {
+
+using BufferClock = std::chrono::steady_clock;
+
+template <typename Rep, typename Period>
+BufferClock::time_point deadlineAfter(const std::chrono::duration<Rep, Period>& timeout)
+{
+    return BufferClock::now() + std::chrono::duration_cast<BufferClock::duration>(timeout);
+}
+
+// waits for ready, without deadline for good, returns ready()
+template <typename Predicate>
+bool waitUntil(std::condition_variable& cv, std::unique_lock<std::mutex>& lock, const BufferClock::time_point* deadline,
+    Predicate ready)
+{
+    if (deadline == nullptr) {
+        cv.wait(lock, ready);
+        return true;
+    }
+    return cv.wait_until(lock, *deadline, ready);
+}
+
+/**
+ * @brief Lets threads sleep until a lock-free structure changes
+ *
+ * Waiter announces itself with prepareWait(), checks its condition once
+ * more and then either cancels or waits. Notifiers touch the mutex only
+ * when somebody announced itself, so the fast path is one atomic load.
+ */
+class EventCount {
+    static constexpr uint64_t WaiterIncrement = 1;
+    static constexpr uint64_t WaiterMask = 0xffffffff;
+    static constexpr unsigned EpochShift = 32;
+    static constexpr uint64_t EpochIncrement = uint64_t{1} << EpochShift;
+
+public:
+    uint32_t prepareWait()
+    {
+        return static_cast<uint32_t>(state.fetch_add(WaiterIncrement) >> EpochShift);
+    }
+
+    void cancelWait()
+    {
+        state.fetch_sub(WaiterIncrement);
+    }
+
+    /**
+     * @brief Sleep until anybody notifies after prepareWait() returned key
+     *
+     * @return false when deadline passed first, null deadline never passes
+     */
+    bool wait(uint32_t key, const BufferClock::time_point* deadline = nullptr)
+    {
+        std::unique_lock<std::mutex> lock{mutex};
+        bool notified = waitUntil(cv, lock, deadline, [&]() {
+            return static_cast<uint32_t>(state.load() >> EpochShift) != key;
+        });
+        state.fetch_sub(WaiterIncrement);
+        return notified;
+    }
+
+    void notifyOne()
+    {
+        notify(false);
+    }
+
+    void notifyAll()
+    {
+        notify(true);
+    }
+
+private:
+    void notify(bool all)
+    {
+        // sequentially consistent with prepareWait(), changes made before are seen by the waiter
+        if ((state.load() & WaiterMask) == 0)
+            return;
+
+        state.fetch_add(EpochIncrement);
+        std::lock_guard<std::mutex> lock{mutex};
+        if (all)
+            cv.notify_all();
+        else
+            cv.notify_one();
+    }
+
+    // waiter count in the low half, epoch in the high half
+    std::atomic<uint64_t> state{0};
+    std::mutex mutex;
+    std::condition_variable cv;
+};
+} // namespace detail
+
+/**
+ * @brief Bounded queue for any number of producers and consumers
+ *
+ * Producers blocked on a full buffer are served in arrival order, a
+ * non-blocking put() does not overtake them.
+ */
+template <typename T, size_t size, BufferPolicy policy = BufferPolicy::Locked>
 class ConditionBuffer {
     using MutexType = std::mutex;
     using LockType = std::unique_lock<MutexType>;
+    using Deadline = detail::BufferClock::time_point;
+
+    // producer waiting for room, has its own condition so only the first one wakes
+    struct Producer {
+        std::condition_variable cv;
+    };
 
     size_t maxBufferSize;
     std::atomic_bool enabled;
     MutexType mutex;
     std::condition_variable cv;
     std::queue<T> queue;
+    std::deque<Producer*> producers;
 
 public:
     ConditionBuffer()
@@ -26,7 +152,11 @@ public:
     void disable()
     {
         enabled = false;
+        LockType lock{mutex};
         cv.notify_all();
+        for (auto producer : producers) {
+            producer->cv.notify_one();
+        }
     }
 
     void enable()
@@ -34,32 +164,969 @@ public:
         enabled = true;
     }
 
+    /**
+     * @brief Append element, fails when the buffer is full
+     */
     bool put(T&& element)
+    {
+        return emplace(std::move(element));
+    }
+
+    bool put(const T& element)
+    {
+        return emplace(element);
+    }
+
+    /**
+     * @brief Construct element in place, fails when the buffer is full
+     */
+    template <typename... Args>
+    bool emplace(Args&&... args)
     {
         {
             LockType lock{mutex};
-            if (queue.size() == maxBufferSize)
+            if (queue.size() == maxBufferSize || !producers.empty())
                 return false;
-            queue.push(std::forward<T>(element));
+            queue.emplace(std::forward<Args>(args)...);
             cv.notify_all();
         }
         return true;
     }
 
+    /**
+     * @brief Append element, waits while the buffer is full
+     *
+     * @return false when the buffer is disabled, element is left untouched
+     */
+    bool putWait(T&& element)
+    {
+        return emplaceUntil(nullptr, std::move(element));
+    }
+
+    bool putWait(const T& element)
+    {
+        return emplaceUntil(nullptr, element);
+    }
+
+    /**
+     * @brief Append element, waits at most timeout for room
+     *
+     * @return false on timeout or when the buffer is disabled, element is left untouched
+     */
+    template <typename Rep, typename Period>
+    bool tryPutFor(T&& element, const std::chrono::duration<Rep, Period>& timeout)
+    {
+        auto deadline = detail::deadlineAfter(timeout);
+        return emplaceUntil(&deadline, std::move(element));
+    }
+
+    template <typename Rep, typename Period>
+    bool tryPutFor(const T& element, const std::chrono::duration<Rep, Period>& timeout)
+    {
+        auto deadline = detail::deadlineAfter(timeout);
+        return emplaceUntil(&deadline, element);
+    }
+
     bool get(T& element)
     {
         LockType lock{mutex};
 
         cv.wait(lock, [&]() { return enabled == false || !queue.empty(); });
 
-        if (!queue.empty()) {
-            element = std::move(queue.front());
+        return pop(element);
+    }
+
+    /**
+     * @brief Take element if there is one
+     */
+    bool tryGet(T& element)
+    {
+        LockType lock{mutex};
+        return pop(element);
+    }
+
+    /**
+     * @brief Take element, waits at most timeout while the buffer is empty
+     */
+    template <typename Rep, typename Period>
+    bool tryGetFor(T& element, const std::chrono::duration<Rep, Period>& timeout)
+    {
+        LockType lock{mutex};
+        cv.wait_for(lock, timeout, [&]() { return enabled == false || !queue.empty(); });
+        return pop(element);
+    }
+
+    /**
+     * @brief Move elements from [first, last) while there is room
+     *
+     * All of them are queued under one lock with one wakeup.
+     *
+     * @return number of elements taken from the front of the range
+     */
+    template <typename Iterator>
+    size_t putBulk(Iterator first, Iterator last)
+    {
+        size_t count = 0;
+        {
+            LockType lock{mutex};
+            if (!producers.empty())
+                return 0;
+            for (; first != last && queue.size() < maxBufferSize; ++first, ++count) {
+                queue.push(std::move(*first));
+            }
+            if (count > 0)
+                cv.notify_all();
+        }
+        return count;
+    }
+
+    /**
+     * @brief Take up to max elements, waits while the buffer is empty
+     *
+     * @return number of elements written to out, 0 once the buffer is disabled and drained
+     */
+    template <typename OutputIterator>
+    size_t getBulk(OutputIterator out, size_t max)
+    {
+        LockType lock{mutex};
+        cv.wait(lock, [&]() { return enabled == false || !queue.empty(); });
+        return take(out, max);
+    }
+
+    /**
+     * @brief Take every queued element without waiting
+     */
+    template <typename OutputIterator>
+    size_t drain(OutputIterator out)
+    {
+        LockType lock{mutex};
+        return take(out, queue.size());
+    }
+
+private:
+    template <typename... Args>
+    bool emplaceUntil(const Deadline* deadline, Args&&... args)
+    {
+        LockType lock{mutex};
+        Producer self;
+        producers.push_back(&self);
+        bool admitted = detail::waitUntil(self.cv, lock, deadline, [&]() {
+            return enabled == false || (producers.front() == &self && queue.size() < maxBufferSize);
+        });
+        producers.erase(std::find(producers.begin(), producers.end(), &self));
+
+        admitted = admitted && enabled;
+        if (admitted) {
+            queue.emplace(std::forward<Args>(args)...);
+            cv.notify_all();
+        }
+        // hand over the turn, whether we used it or gave up
+        wakeProducer();
+        return admitted;
+    }
+
+    // called under the lock whenever room may have appeared
+    void wakeProducer()
+    {
+        if (!producers.empty() && queue.size() < maxBufferSize)
+            producers.front()->cv.notify_one();
+    }
+
+    bool pop(T& element)
+    {
+        if (queue.empty())
+            return false;
+
+        element = std::move(queue.front());
+        queue.pop();
+        wakeProducer();
+        return true;
+    }
+
+    template <typename OutputIterator>
+    size_t take(OutputIterator& out, size_t max)
+    {
+        size_t count = 0;
+        for (; count < max && !queue.empty(); ++count) {
+            *out++ = std::move(queue.front());
             queue.pop();
-            return true;
         }
+        wakeProducer();
+        return count;
+    }
+};
+
+/**
+ * @brief Ring buffer for one producer and one consumer thread
+ *
+ * Storage is part of the object and the indices live on separate cache
+ * lines, so put() and get() do not touch any lock while the buffer has
+ * elements. Consumer blocks only when the buffer is empty, put() never
+ * blocks and fails when size elements are queued, putWait() blocks while
+ * the buffer is full.
+ */
+template <typename T, size_t size>
+class ConditionBuffer<T, size, BufferPolicy::Spsc> {
+    static_assert(size > 0, "ConditionBuffer needs room for at least one element");
+
+    using Deadline = detail::BufferClock::time_point;
+
+    static constexpr size_t CacheLine = 64;
+    static constexpr int SpinRounds = 16;
+
+    static constexpr size_t roundUp(size_t value)
+    {
+        size_t power = 1;
+        while (power < value) {
+            power *= 2;
+        }
+        return power;
+    }
+
+    // indices only grow, power of two capacity turns modulo into mask
+    static constexpr size_t Capacity = roundUp(size);
+
+    struct Slot {
+        alignas(T) unsigned char bytes[sizeof(T)];
+    };
+
+public:
+    ConditionBuffer() = default;
+
+    ConditionBuffer(const ConditionBuffer&) = delete;
+    ConditionBuffer& operator=(const ConditionBuffer&) = delete;
+
+    ~ConditionBuffer()
+    {
+        for (size_t i = head; i != tail; ++i) {
+            slot(i)->~T();
+        }
+    }
+
+    void disable()
+    {
+        enabled = false;
+        std::lock_guard<std::mutex> lock{mutex};
+        cv.notify_all();
+        spaceCv.notify_all();
+    }
+
+    void enable()
+    {
+        enabled = true;
+    }
+
+    /**
+     * @brief Append element, called from the producer thread only
+     */
+    bool put(T&& element)
+    {
+        return emplace(std::move(element));
+    }
+
+    bool put(const T& element)
+    {
+        return emplace(element);
+    }
+
+    /**
+     * @brief Construct element in place, called from the producer thread only
+     */
+    template <typename... Args>
+    bool emplace(Args&&... args)
+    {
+        size_t current = tail.load(std::memory_order_relaxed);
+        if (current - cachedHead == size) {
+            cachedHead = head.load(std::memory_order_acquire);
+            if (current - cachedHead == size)
+                return false;
+        }
+
+        new (slot(current)) T(std::forward<Args>(args)...);
+
+        // tail and waiting are sequentially consistent, so either we see the
+        // waiting consumer or it sees the new element in its wait predicate
+        tail.store(current + 1);
+        if (waiting.load()) {
+            std::lock_guard<std::mutex> lock{mutex};
+            cv.notify_one();
+        }
+        return true;
+    }
+
+    /**
+     * @brief Append element, waits while the buffer is full, called from the producer thread only
+     *
+     * @return false when the buffer is disabled, element is left untouched
+     */
+    bool putWait(T&& element)
+    {
+        return emplaceUntil(nullptr, std::move(element));
+    }
+
+    bool putWait(const T& element)
+    {
+        return emplaceUntil(nullptr, element);
+    }
+
+    /**
+     * @brief Append element, waits at most timeout for room, called from the producer thread only
+     *
+     * @return false on timeout or when the buffer is disabled, element is left untouched
+     */
+    template <typename Rep, typename Period>
+    bool tryPutFor(T&& element, const std::chrono::duration<Rep, Period>& timeout)
+    {
+        auto deadline = detail::deadlineAfter(timeout);
+        return emplaceUntil(&deadline, std::move(element));
+    }
+
+    template <typename Rep, typename Period>
+    bool tryPutFor(const T& element, const std::chrono::duration<Rep, Period>& timeout)
+    {
+        auto deadline = detail::deadlineAfter(timeout);
+        return emplaceUntil(&deadline, element);
+    }
+
+    /**
+     * @brief Take element, called from the consumer thread only
+     *
+     * Waits while the buffer is empty, returns false once the buffer is
+     * disabled and drained.
+     */
+    bool get(T& element)
+    {
+        return getUntil(nullptr, element);
+    }
+
+    /**
+     * @brief Take element, waits at most timeout while the buffer is empty, called from the consumer thread only
+     */
+    template <typename Rep, typename Period>
+    bool tryGetFor(T& element, const std::chrono::duration<Rep, Period>& timeout)
+    {
+        auto deadline = detail::deadlineAfter(timeout);
+        return getUntil(&deadline, element);
+    }
+
+    /**
+     * @brief Take element if there is one, called from the consumer thread only
+     */
+    bool tryGet(T& element)
+    {
+        size_t current = head.load(std::memory_order_relaxed);
+        if (current == cachedTail) {
+            cachedTail = tail.load(std::memory_order_acquire);
+            if (current == cachedTail) {
+                // a consumer which only polls must still release the producer
+                wakeProducer();
+                return false;
+            }
+        }
+
+        T* stored = slot(current);
+        element = std::move(*stored);
+        stored->~T();
+        head.store(current + 1, std::memory_order_release);
+        wakeProducer();
+        return true;
+    }
+
+    /**
+     * @brief Move elements from [first, last) while there is room, called from the producer thread only
+     *
+     * Elements are published by a single store of the tail.
+     *
+     * @return number of elements taken from the front of the range
+     */
+    template <typename Iterator>
+    size_t putBulk(Iterator first, Iterator last)
+    {
+        size_t current = tail.load(std::memory_order_relaxed);
+        size_t end = current;
+        for (; first != last; ++first, ++end) {
+            if (end - cachedHead == size) {
+                cachedHead = head.load(std::memory_order_acquire);
+                if (end - cachedHead == size)
+                    break;
+            }
+            new (slot(end)) T(std::move(*first));
+        }
+        if (end == current)
+            return 0;
 
-        return false;
+        tail.store(end);
+        if (waiting.load()) {
+            std::lock_guard<std::mutex> lock{mutex};
+            cv.notify_one();
+        }
+        return end - current;
+    }
+
+    /**
+     * @brief Take up to max elements, called from the consumer thread only
+     *
+     * Waits while the buffer is empty.
+     *
+     * @return number of elements written to out, 0 once the buffer is disabled and drained
+     */
+    template <typename OutputIterator>
+    size_t getBulk(OutputIterator out, size_t max)
+    {
+        for (int i = 0; i < SpinRounds; ++i) {
+            if (size_t count = take(out, max))
+                return count;
+            std::this_thread::yield();
+        }
+
+        waitForElements(nullptr);
+        return take(out, max);
+    }
+
+    /**
+     * @brief Take every queued element without waiting, called from the consumer thread only
+     */
+    template <typename OutputIterator>
+    size_t drain(OutputIterator out)
+    {
+        return take(out, size);
+    }
+
+private:
+    template <typename OutputIterator>
+    size_t take(OutputIterator& out, size_t max)
+    {
+        size_t current = head.load(std::memory_order_relaxed);
+        if (max > cachedTail - current)
+            cachedTail = tail.load(std::memory_order_acquire);
+
+        size_t end = current + std::min(max, cachedTail - current);
+        for (size_t i = current; i != end; ++i) {
+            T* stored = slot(i);
+            *out++ = std::move(*stored);
+            stored->~T();
+        }
+        if (end != current)
+            head.store(end, std::memory_order_release);
+        wakeProducer();
+        return end - current;
+    }
+
+    template <typename... Args>
+    bool emplaceUntil(const Deadline* deadline, Args&&... args)
+    {
+        for (int i = 0; i < SpinRounds; ++i) {
+            if (enabled == false)
+                return false;
+            if (emplace(std::forward<Args>(args)...))
+                return true;
+            std::this_thread::yield();
+        }
+
+        while (true) {
+            std::unique_lock<std::mutex> lock{mutex};
+            producerWaiting.store(true, std::memory_order_relaxed);
+            bool woken = detail::waitUntil(spaceCv, lock, deadline, [&]() { return enabled == false || !full(); });
+            producerWaiting.store(false, std::memory_order_relaxed);
+            lock.unlock();
+
+            if (enabled == false)
+                return false;
+            if (emplace(std::forward<Args>(args)...))
+                return true;
+            if (!woken)
+                return false;
+        }
+    }
+
+    bool getUntil(const Deadline* deadline, T& element)
+    {
+        // give the producer a chance before paying for a sleep and a wakeup
+        for (int i = 0; i < SpinRounds; ++i) {
+            if (tryGet(element))
+                return true;
+            std::this_thread::yield();
+        }
+
+        waitForElements(deadline);
+        return tryGet(element);
+    }
+
+    void waitForElements(const Deadline* deadline)
+    {
+        std::unique_lock<std::mutex> lock{mutex};
+        waiting.store(true);
+        // producer decides to sleep under the same lock, so it either saw our
+        // last head or we see its flag here, even if wakeProducer() missed it
+        if (producerWaiting.load(std::memory_order_relaxed))
+            spaceCv.notify_one();
+        detail::waitUntil(cv, lock, deadline, [&]() { return enabled == false || !empty(); });
+        waiting.store(false, std::memory_order_relaxed);
+    }
+
+    // relaxed hint keeping get() cheap, may miss a producer which just went
+    // to sleep; the next get() or waitForElements() catches it then
+    void wakeProducer()
+    {
+        if (producerWaiting.load(std::memory_order_relaxed)) {
+            std::lock_guard<std::mutex> lock{mutex};
+            spaceCv.notify_one();
+        }
+    }
+
+    T* slot(size_t index)
+    {
+        return std::launder(reinterpret_cast<T*>(storage[index & (Capacity - 1)].bytes));
+    }
+
+    bool empty() const
+    {
+        return head.load(std::memory_order_relaxed) == tail.load();
+    }
+
+    bool full() const
+    {
+        return tail.load(std::memory_order_relaxed) - head.load() == size;
+    }
+
+    // written by producer
+    alignas(CacheLine) std::atomic_size_t tail{0};
+    size_t cachedHead = 0;
+
+    // written by consumer
+    alignas(CacheLine) std::atomic_size_t head{0};
+    size_t cachedTail = 0;
+
+    // rarely written, read by producer on every put and by consumer on every get
+    alignas(CacheLine) std::atomic_bool waiting{false};
+    std::atomic_bool producerWaiting{false};
+    std::atomic_bool enabled{true};
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::condition_variable spaceCv;
+
+    alignas(CacheLine) Slot storage[Capacity];
+};
+
+/**
+ * @brief Bounded queue for any number of producers and consumers
+ *
+ * Every slot carries a sequence number telling whether it is free for the
+ * producer of a given round or filled for its consumer, so producers and
+ * consumers only compete on their own position counter. Idle consumers
+ * sleep on an EventCount instead of spinning, so do producers blocked in
+ * putWait(). put() never blocks and fails when size elements are queued.
+ */
+template <typename T, size_t size>
+class ConditionBuffer<T, size, BufferPolicy::Mpmc> {
+    static_assert(size > 0, "ConditionBuffer needs room for at least one element");
+
+    using Deadline = detail::BufferClock::time_point;
+
+    static constexpr size_t CacheLine = 64;
+    static constexpr int SpinRounds = 16;
+
+    struct Cell {
+        std::atomic_size_t sequence;
+        alignas(T) unsigned char bytes[sizeof(T)];
+    };
+
+public:
+    ConditionBuffer()
+    {
+        for (size_t i = 0; i < size; ++i) {
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    ConditionBuffer(const ConditionBuffer&) = delete;
+    ConditionBuffer& operator=(const ConditionBuffer&) = delete;
+
+    ~ConditionBuffer()
+    {
+        for (size_t i = dequeuePos; i != enqueuePos; ++i) {
+            value(cells[i % size])->~T();
+        }
+    }
+
+    void disable()
+    {
+        enabled = false;
+        events.notifyAll();
+        space.notifyAll();
+    }
+
+    void enable()
+    {
+        enabled = true;
+    }
+
+    /**
+     * @brief Append element, fails when the buffer is full
+     */
+    bool put(T&& element)
+    {
+        return emplace(std::move(element));
+    }
+
+    bool put(const T& element)
+    {
+        return emplace(element);
+    }
+
+    /**
+     * @brief Construct element in place, fails when the buffer is full
+     */
+    template <typename... Args>
+    bool emplace(Args&&... args)
+    {
+        size_t position = enqueuePos.load(std::memory_order_relaxed);
+        Cell* cell;
+        while (true) {
+            cell = &cells[position % size];
+            // sequentially consistent, pairs with the release of the slot by a consumer
+            size_t sequence = cell->sequence.load();
+            auto difference = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(position);
+            if (difference == 0) {
+                if (enqueuePos.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (difference < 0) {
+                // slot still holds the element of the previous round
+                return false;
+            }
+            else {
+                position = enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+
+        new (cell->bytes) T(std::forward<Args>(args)...);
+        // sequentially consistent, pairs with EventCount::prepareWait() of a consumer
+        cell->sequence.store(position + 1);
+        events.notifyOne();
+        return true;
+    }
+
+    /**
+     * @brief Append element, waits while the buffer is full
+     *
+     * Waiting producers are not queued, whichever retries first after a
+     * consumer frees a slot gets it.
+     *
+     * @return false when the buffer is disabled, element is left untouched
+     */
+    bool putWait(T&& element)
+    {
+        return emplaceUntil(nullptr, std::move(element));
+    }
+
+    bool putWait(const T& element)
+    {
+        return emplaceUntil(nullptr, element);
+    }
+
+    /**
+     * @brief Append element, waits at most timeout for room
+     *
+     * @return false on timeout or when the buffer is disabled, element is left untouched
+     */
+    template <typename Rep, typename Period>
+    bool tryPutFor(T&& element, const std::chrono::duration<Rep, Period>& timeout)
+    {
+        auto deadline = detail::deadlineAfter(timeout);
+        return emplaceUntil(&deadline, std::move(element));
+    }
+
+    template <typename Rep, typename Period>
+    bool tryPutFor(const T& element, const std::chrono::duration<Rep, Period>& timeout)
+    {
+        auto deadline = detail::deadlineAfter(timeout);
+        return emplaceUntil(&deadline, element);
+    }
+
+    /**
+     * @brief Take element, waits while the buffer is empty
+     *
+     * Returns false once the buffer is disabled and drained.
+     */
+    bool get(T& element)
+    {
+        return getUntil(nullptr, element);
+    }
+
+    /**
+     * @brief Take element, waits at most timeout while the buffer is empty
+     */
+    template <typename Rep, typename Period>
+    bool tryGetFor(T& element, const std::chrono::duration<Rep, Period>& timeout)
+    {
+        auto deadline = detail::deadlineAfter(timeout);
+        return getUntil(&deadline, element);
+    }
+
+    /**
+     * @brief Take element if there is one
+     */
+    bool tryGet(T& element)
+    {
+        size_t position = dequeuePos.load(std::memory_order_relaxed);
+        Cell* cell;
+        while (true) {
+            cell = &cells[position % size];
+            size_t sequence = cell->sequence.load();
+            auto difference = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(position + 1);
+            if (difference == 0) {
+                if (dequeuePos.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (difference < 0) {
+                return false;
+            }
+            else {
+                position = dequeuePos.load(std::memory_order_relaxed);
+            }
+        }
+
+        T* stored = value(*cell);
+        element = std::move(*stored);
+        stored->~T();
+        // free the slot for the producer of the next round, sequentially
+        // consistent as it pairs with EventCount::prepareWait() of a producer
+        cell->sequence.store(position + size);
+        space.notifyOne();
+        return true;
+    }
+
+    /**
+     * @brief Move elements from [first, last) while there is room
+     *
+     * Consecutive free slots are claimed by one update of the position and
+     * consumers get a single wakeup for the whole batch.
+     *
+     * @return number of elements taken from the front of the range
+     */
+    template <typename Iterator>
+    size_t putBulk(Iterator first, Iterator last)
+    {
+        auto wanted = static_cast<size_t>(std::distance(first, last));
+        size_t position = enqueuePos.load(std::memory_order_relaxed);
+        size_t count;
+        do {
+            count = 0;
+            while (count < wanted && count < size
+                && cells[(position + count) % size].sequence.load() == position + count) {
+                ++count;
+            }
+            if (count == 0)
+                return 0;
+        } while (!enqueuePos.compare_exchange_weak(position, position + count, std::memory_order_relaxed));
+
+        for (size_t i = 0; i < count; ++i, ++first) {
+            Cell& cell = cells[(position + i) % size];
+            new (cell.bytes) T(std::move(*first));
+            cell.sequence.store(position + i + 1);
+        }
+        events.notifyOne();
+        return count;
     }
+
+    /**
+     * @brief Take up to max elements, waits while the buffer is empty
+     *
+     * @return number of elements written to out, 0 once the buffer is disabled and drained
+     */
+    template <typename OutputIterator>
+    size_t getBulk(OutputIterator out, size_t max)
+    {
+        if (max == 0)
+            return 0;
+
+        for (int i = 0; i < SpinRounds; ++i) {
+            if (size_t count = take(out, max))
+                return count;
+            std::this_thread::yield();
+        }
+
+        while (true) {
+            auto key = events.prepareWait();
+            if (size_t count = take(out, max)) {
+                events.cancelWait();
+                return count;
+            }
+            if (enabled == false) {
+                events.cancelWait();
+                return 0;
+            }
+            events.wait(key);
+            if (size_t count = take(out, max))
+                return count;
+        }
+    }
+
+    /**
+     * @brief Take every element published so far without waiting
+     */
+    template <typename OutputIterator>
+    size_t drain(OutputIterator out)
+    {
+        return take(out, size);
+    }
+
+    /**
+     * @brief Wait at most timeout until an element can be taken, without taking it
+     *
+     * @return false on timeout or once the buffer is disabled and empty
+     */
+    template <typename Rep, typename Period>
+    bool waitFor(const std::chrono::duration<Rep, Period>& timeout)
+    {
+        auto deadline = detail::deadlineAfter(timeout);
+        while (true) {
+            auto key = events.prepareWait();
+            if (published()) {
+                events.cancelWait();
+                return true;
+            }
+            if (enabled == false) {
+                events.cancelWait();
+                return false;
+            }
+            if (!events.wait(key, &deadline))
+                return published();
+        }
+    }
+
+    /**
+     * @brief Hand the elements published so far to visit, in order, leaving them in the buffer
+     *
+     * Only reads sequence numbers and elements: no lock, no notification, no
+     * element is moved or destroyed, so a signal handler may call it. The
+     * caller keeps consumers from taking elements meanwhile.
+     */
+    template <typename F>
+    size_t peek(F&& visit)
+    {
+        size_t position = dequeuePos.load();
+        size_t count = 0;
+        while (count < size && cells[(position + count) % size].sequence.load() == position + count + 1) {
+            visit(static_cast<const T&>(*value(cells[(position + count) % size])));
+            ++count;
+        }
+        return count;
+    }
+
+    // positions handed to producers so far, consumers take them in the same order
+    size_t putCount() const
+    {
+        return enqueuePos.load();
+    }
+
+    // positions taken by consumers so far
+    size_t takeCount() const
+    {
+        return dequeuePos.load();
+    }
+
+private:
+    bool published()
+    {
+        size_t position = dequeuePos.load();
+        return cells[position % size].sequence.load() == position + 1;
+    }
+
+    // claims consecutive filled slots with one update of the position
+    template <typename OutputIterator>
+    size_t take(OutputIterator& out, size_t max)
+    {
+        size_t position = dequeuePos.load(std::memory_order_relaxed);
+        size_t count;
+        do {
+            count = 0;
+            while (count < max && count < size && cells[(position + count) % size].sequence.load() == position + count + 1) {
+                ++count;
+            }
+            if (count == 0)
+                return 0;
+        } while (!dequeuePos.compare_exchange_weak(position, position + count, std::memory_order_relaxed));
+
+        for (size_t i = 0; i < count; ++i) {
+            Cell& cell = cells[(position + i) % size];
+            T* stored = value(cell);
+            *out++ = std::move(*stored);
+            stored->~T();
+            cell.sequence.store(position + i + size);
+        }
+        if (count == 1)
+            space.notifyOne();
+        else
+            space.notifyAll();
+        return count;
+    }
+
+    template <typename... Args>
+    bool emplaceUntil(const Deadline* deadline, Args&&... args)
+    {
+        for (int i = 0; i < SpinRounds; ++i) {
+            if (enabled == false)
+                return false;
+            if (emplace(std::forward<Args>(args)...))
+                return true;
+            std::this_thread::yield();
+        }
+
+        while (true) {
+            auto key = space.prepareWait();
+            if (enabled == false) {
+                space.cancelWait();
+                return false;
+            }
+            if (emplace(std::forward<Args>(args)...)) {
+                space.cancelWait();
+                return true;
+            }
+            if (!space.wait(key, deadline))
+                return enabled && emplace(std::forward<Args>(args)...);
+        }
+    }
+
+    bool getUntil(const Deadline* deadline, T& element)
+    {
+        // give producers a chance before paying for a sleep and a wakeup
+        for (int i = 0; i < SpinRounds; ++i) {
+            if (tryGet(element))
+                return true;
+            std::this_thread::yield();
+        }
+
+        while (true) {
+            auto key = events.prepareWait();
+            if (tryGet(element)) {
+                events.cancelWait();
+                return true;
+            }
+            if (enabled == false) {
+                events.cancelWait();
+                return false;
+            }
+            if (!events.wait(key, deadline))
+                return tryGet(element);
+            if (tryGet(element))
+                return true;
+        }
+    }
+
+    static T* value(Cell& cell)
+    {
+        return std::launder(reinterpret_cast<T*>(cell.bytes));
+    }
+
+    alignas(CacheLine) std::atomic_size_t enqueuePos{0};
+    alignas(CacheLine) std::atomic_size_t dequeuePos{0};
+    alignas(CacheLine) std::atomic_bool enabled{true};
+    // consumers wait for elements on events, producers for free slots on space
+    detail::EventCount events;
+    detail::EventCount space;
+    alignas(CacheLine) Cell cells[size];
 };
 }
 
@@ -0,0 +1,332 @@
+#ifndef SIMPLE_COROUTINE_HPP
+#define SIMPLE_COROUTINE_HPP
+
+#ifndef __cpp_impl_coroutine
+#error "Simple/Coroutine.hpp needs C++20 coroutines, configure with -DSIMPLE_CXX20=ON"
+#endif
+
+#include <condition_variable>
+#include <coroutine>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+#include "Future.hpp"
+#include "ThreadPool.hpp"
+
+namespace Simple {
+
+template <typename T = void>
+class Task;
+
+namespace detail {
+
+struct TaskPromiseBase {
+    // resumes whoever awaited the task, symmetric transfer keeps the stack flat
+    struct FinalAwaiter {
+        bool await_ready() const noexcept
+        {
+            return false;
+        }
+
+        template <typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept
+        {
+            return handle.promise().continuation;
+        }
+
+        void await_resume() const noexcept
+        {
+        }
+    };
+
+    std::suspend_always initial_suspend() const noexcept
+    {
+        return {};
+    }
+
+    FinalAwaiter final_suspend() const noexcept
+    {
+        return {};
+    }
+
+    void unhandled_exception() noexcept
+    {
+        error = std::current_exception();
+    }
+
+    std::coroutine_handle<> continuation = std::noop_coroutine();
+    std::exception_ptr error;
+};
+
+template <typename T>
+struct TaskPromise : TaskPromiseBase {
+    Task<T> get_return_object();
+
+    template <typename V>
+    void return_value(V&& result)
+    {
+        value.emplace(std::forward<V>(result));
+    }
+
+    T result()
+    {
+        if (error)
+            std::rethrow_exception(error);
+        return std::move(*value);
+    }
+
+    std::optional<T> value;
+};
+
+template <>
+struct TaskPromise<void> : TaskPromiseBase {
+    Task<void> get_return_object();
+
+    void return_void() const noexcept
+    {
+    }
+
+    void result()
+    {
+        if (error)
+            std::rethrow_exception(error);
+    }
+};
+
+// coroutine which starts right away and frees itself when done
+struct Detached {
+    struct promise_type {
+        Detached get_return_object() const noexcept
+        {
+            return {};
+        }
+
+        std::suspend_never initial_suspend() const noexcept
+        {
+            return {};
+        }
+
+        std::suspend_never final_suspend() const noexcept
+        {
+            return {};
+        }
+
+        void return_void() const noexcept
+        {
+        }
+
+        void unhandled_exception() const noexcept
+        {
+            std::terminate();
+        }
+    };
+};
+} // namespace detail
+
+/**
+ * @brief Lazily started coroutine producing T
+ *
+ * The body runs only once the task is awaited, the awaiting coroutine is
+ * resumed on whatever thread finishes the task. Use ThreadPool::schedule()
+ * inside the body to move to a worker.
+ */
+template <typename T>
+class [[nodiscard]] Task {
+public:
+    using promise_type = detail::TaskPromise<T>;
+
+    Task(Task&& other) noexcept
+        : handle{std::exchange(other.handle, nullptr)}
+    {
+    }
+
+    Task& operator=(Task&& other) noexcept
+    {
+        if (this != &other) {
+            if (handle)
+                handle.destroy();
+            handle = std::exchange(other.handle, nullptr);
+        }
+        return *this;
+    }
+
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    ~Task()
+    {
+        if (handle)
+            handle.destroy();
+    }
+
+    auto operator co_await() && noexcept
+    {
+        struct Awaiter {
+            std::coroutine_handle<promise_type> handle;
+
+            bool await_ready() const noexcept
+            {
+                return handle.done();
+            }
+
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+            {
+                handle.promise().continuation = awaiting;
+                return handle;
+            }
+
+            T await_resume()
+            {
+                return handle.promise().result();
+            }
+        };
+        return Awaiter{handle};
+    }
+
+private:
+    friend struct detail::TaskPromise<T>;
+
+    explicit Task(std::coroutine_handle<promise_type> handle)
+        : handle{handle}
+    {
+    }
+
+    std::coroutine_handle<promise_type> handle;
+};
+
+namespace detail {
+
+template <typename T>
+Task<T> TaskPromise<T>::get_return_object()
+{
+    return Task<T>{std::coroutine_handle<TaskPromise>::from_promise(*this)};
+}
+
+inline Task<void> TaskPromise<void>::get_return_object()
+{
+    return Task<void>{std::coroutine_handle<TaskPromise>::from_promise(*this)};
+}
+
+template <typename T>
+struct SyncWaitState {
+    std::mutex mtx;
+    std::condition_variable cv;
+    bool done = false;
+    std::optional<Stored<T>> value;
+    std::exception_ptr error;
+};
+
+template <typename T>
+Detached runSyncWait(Task<T> task, SyncWaitState<T>& state)
+{
+    try {
+        if constexpr (std::is_void<T>::value) {
+            co_await std::move(task);
+            state.value.emplace();
+        }
+        else {
+            state.value.emplace(co_await std::move(task));
+        }
+    }
+    catch (...) {
+        state.error = std::current_exception();
+    }
+
+    // notify under the lock, state lives on the stack of the waiting thread
+    std::lock_guard<std::mutex> lock{state.mtx};
+    state.done = true;
+    state.cv.notify_all();
+}
+
+template <typename T>
+Detached runSpawned(ThreadPool& pool, Task<T> task, Promise<T> promise)
+{
+    co_await pool.schedule();
+    try {
+        if constexpr (std::is_void<T>::value) {
+            co_await std::move(task);
+            promise.setValue();
+        }
+        else {
+            promise.setValue(co_await std::move(task));
+        }
+    }
+    catch (...) {
+        promise.setException(std::current_exception());
+    }
+}
+} // namespace detail
+
+/**
+ * @brief Run task and block the calling thread until it finishes
+ *
+ * Meant for main() and tests, never call it from a worker of the pool the
+ * task runs on.
+ */
+template <typename T>
+T syncWait(Task<T> task)
+{
+    detail::SyncWaitState<T> state;
+    detail::runSyncWait(std::move(task), state);
+
+    std::unique_lock<std::mutex> lock{state.mtx};
+    state.cv.wait(lock, [&]() { return state.done; });
+    if (state.error)
+        std::rethrow_exception(state.error);
+    if constexpr (!std::is_void<T>::value)
+        return std::move(*state.value);
+}
+
+/**
+ * @brief Start task on the pool right away and get its result as Future
+ */
+template <typename T>
+Future<T> spawn(ThreadPool& pool, Task<T> task)
+{
+    Promise<T> promise;
+    auto future = promise.getFuture(&pool);
+    detail::runSpawned(pool, std::move(task), std::move(promise));
+    return future;
+}
+
+/**
+ * @brief Await Future without blocking a thread
+ *
+ * The coroutine continues on the executor of the future, or on the thread
+ * which completes it when there is none.
+ */
+template <typename T>
+auto operator co_await(Future<T>&& future)
+{
+    struct Awaiter {
+        Future<T> future;
+
+        bool await_ready() const
+        {
+            return future.isReady();
+        }
+
+        void await_suspend(std::coroutine_handle<> handle)
+        {
+            ThreadPool* pool = future.executor();
+            detail::Continuation::state(future)->onReady([handle, pool]() {
+                if (pool != nullptr)
+                    pool->post([handle]() { handle.resume(); });
+                else
+                    handle.resume();
+            });
+        }
+
+        T await_resume()
+        {
+            return future.get();
+        }
+    };
+    return Awaiter{std::move(future)};
+}
+} // namespace Simple
+
+#endif /* ifndef SIMPLE_COROUTINE_HPP */
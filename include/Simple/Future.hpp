@@ -0,0 +1,519 @@
+#ifndef SIMPLE_FUTURE_HPP
+#define SIMPLE_FUTURE_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "PoolAllocator.hpp"
+#include "TaskFunction.hpp"
+#include "ThreadPool.hpp"
+
+namespace Simple {
+
+template <typename T>
+class Future;
+
+template <typename T>
+class Promise;
+
+namespace detail {
+
+// stands in for the value of Future<void>
+struct Unit {
+};
+
+template <typename T>
+using Stored = std::conditional_t<std::is_void<T>::value, Unit, T>;
+
+/**
+ * @brief Result slot shared by Promise and Future
+ *
+ * One callback can be attached, it runs on the thread which completes
+ * the state, or immediately when the state is already complete.
+ */
+template <typename T>
+class FutureState {
+public:
+    template <typename... V>
+    void setValue(V&&... value)
+    {
+        complete([&]() { this->value.emplace(std::forward<V>(value)...); });
+    }
+
+    void setException(std::exception_ptr error)
+    {
+        complete([&]() { this->error = error; });
+    }
+
+    void onReady(TaskFunction&& callback)
+    {
+        {
+            std::lock_guard<std::mutex> lock{mtx};
+            if (!ready) {
+                this->callback = std::move(callback);
+                return;
+            }
+        }
+        callback();
+    }
+
+    bool isReady()
+    {
+        std::lock_guard<std::mutex> lock{mtx};
+        return ready;
+    }
+
+    void wait()
+    {
+        std::unique_lock<std::mutex> lock{mtx};
+        cv.wait(lock, [&]() { return ready; });
+    }
+
+    // only valid once the state is ready
+    bool failed() const
+    {
+        return error != nullptr;
+    }
+
+    std::exception_ptr exception() const
+    {
+        return error;
+    }
+
+    Stored<T> take()
+    {
+        wait();
+        if (error)
+            std::rethrow_exception(error);
+        return std::move(*value);
+    }
+
+private:
+    template <typename Store>
+    void complete(Store store)
+    {
+        TaskFunction pending;
+        {
+            std::lock_guard<std::mutex> lock{mtx};
+            if (ready)
+                throw std::future_error(std::future_errc::promise_already_satisfied);
+            store();
+            ready = true;
+            pending = std::move(callback);
+        }
+        cv.notify_all();
+        if (pending)
+            pending();
+    }
+
+    std::mutex mtx;
+    std::condition_variable cv;
+    bool ready = false;
+    std::optional<Stored<T>> value;
+    std::exception_ptr error;
+    TaskFunction callback;
+};
+
+template <typename T>
+struct IsFuture : std::false_type {
+};
+
+template <typename T>
+struct IsFuture<Future<T>> : std::true_type {
+};
+
+template <typename R>
+struct Flatten {
+    using type = R;
+};
+
+template <typename T>
+struct Flatten<Future<T>> {
+    using type = T;
+};
+
+template <typename F, typename T>
+struct ContinuationResult {
+    using type = std::invoke_result_t<F&, T>;
+};
+
+template <typename F>
+struct ContinuationResult<F, void> {
+    using type = std::invoke_result_t<F&>;
+};
+
+struct Continuation {
+    /**
+     * @brief Store result of call into promise
+     *
+     * A future returned by call is chained to the promise instead of being
+     * waited for, so no worker blocks on nested asynchronous work.
+     */
+    template <typename R, typename Call>
+    static void fulfil(Promise<typename Flatten<R>::type>& promise, Call&& call)
+    {
+        try {
+            if constexpr (IsFuture<R>::value) {
+                call().forward(std::move(promise));
+            }
+            else if constexpr (std::is_void<R>::value) {
+                call();
+                promise.setValue();
+            }
+            else {
+                promise.setValue(call());
+            }
+        }
+        catch (...) {
+            promise.setException(std::current_exception());
+        }
+    }
+
+    template <typename T>
+    static std::shared_ptr<FutureState<T>>& state(Future<T>& future)
+    {
+        return future.state;
+    }
+};
+} // namespace detail
+
+/**
+ * @brief Future with continuations
+ *
+ * Unlike std::future the result can be consumed with then(), which runs
+ * the continuation on the pool once the value is there, instead of
+ * blocking a thread in get(). Workers of a bounded pool should never call
+ * get() on a future another task of the same pool completes.
+ */
+template <typename T>
+class Future {
+    using State = detail::FutureState<T>;
+
+public:
+    Future() = default;
+
+    Future(Future&&) noexcept = default;
+    Future& operator=(Future&&) noexcept = default;
+
+    bool valid() const
+    {
+        return state != nullptr;
+    }
+
+    bool isReady() const
+    {
+        return state->isReady();
+    }
+
+    void wait() const
+    {
+        state->wait();
+    }
+
+    /**
+     * @brief Block until the value is there and take it, rethrows stored exception
+     */
+    T get()
+    {
+        auto current = std::move(state);
+        if constexpr (std::is_void<T>::value)
+            current->take();
+        else
+            return current->take();
+    }
+
+    /**
+     * @brief Pool continuations of this future run on, nullptr runs them inline
+     */
+    ThreadPool* executor() const
+    {
+        return pool;
+    }
+
+    /**
+     * @brief Call fun with the value on the executor once it is ready
+     *
+     * Exception of this future skips fun and goes straight to the returned
+     * future. When fun returns Future<U> the result is Future<U> as well.
+     */
+    template <typename F>
+    auto then(F&& fun)
+    {
+        return then(pool, std::forward<F>(fun));
+    }
+
+    template <typename F>
+    auto then(ThreadPool& pool, F&& fun)
+    {
+        return then(&pool, std::forward<F>(fun));
+    }
+
+private:
+    friend class Promise<T>;
+    friend struct detail::Continuation;
+
+    Future(std::shared_ptr<State> state, ThreadPool* pool)
+        : state{std::move(state)}
+        , pool{pool}
+    {
+    }
+
+    template <typename F>
+    auto then(ThreadPool* executor, F&& fun)
+    {
+        using Result = typename detail::ContinuationResult<std::decay_t<F>, T>::type;
+        using Value = typename detail::Flatten<Result>::type;
+
+        Promise<Value> promise;
+        Future<Value> result = promise.getFuture(executor);
+        auto current = std::move(state);
+        auto* previous = current.get();
+
+        previous->onReady([current = std::move(current), promise = std::move(promise),
+                           fun = std::forward<F>(fun), executor]() mutable {
+            auto job = [current = std::move(current), promise = std::move(promise),
+                        fun = std::move(fun)]() mutable {
+                if (current->failed()) {
+                    promise.setException(current->exception());
+                    return;
+                }
+                detail::Continuation::fulfil<Result>(promise, [&]() -> Result {
+                    if constexpr (std::is_void<T>::value)
+                        return std::invoke(fun);
+                    else
+                        return std::invoke(fun, current->take());
+                });
+            };
+            if (executor != nullptr)
+                executor->post(std::move(job));
+            else
+                job();
+        });
+        return result;
+    }
+
+    // complete promise with the outcome of this future
+    void forward(Promise<T>&& promise)
+    {
+        auto current = std::move(state);
+        auto* previous = current.get();
+        previous->onReady([current = std::move(current), promise = std::move(promise)]() mutable {
+            if (current->failed())
+                promise.setException(current->exception());
+            else
+                promise.setValue(current->take());
+        });
+    }
+
+    std::shared_ptr<State> state;
+    ThreadPool* pool = nullptr;
+};
+
+/**
+ * @brief Producer side of Future
+ *
+ * Promise destroyed without result completes its future with
+ * std::future_errc::broken_promise.
+ */
+template <typename T>
+class Promise {
+    using State = detail::FutureState<T>;
+
+public:
+    Promise()
+        : state{std::allocate_shared<State>(PoolAllocator<State>{})}
+    {
+    }
+
+    Promise(Promise&&) noexcept = default;
+
+    Promise& operator=(Promise&& other) noexcept
+    {
+        if (this != &other) {
+            abandon();
+            state = std::move(other.state);
+        }
+        return *this;
+    }
+
+    ~Promise()
+    {
+        abandon();
+    }
+
+    /**
+     * @brief Future sharing state with this promise, continuations run on pool
+     */
+    Future<T> getFuture(ThreadPool* pool = nullptr)
+    {
+        return Future<T>{state, pool};
+    }
+
+    /**
+     * @brief Complete the future, throws std::future_error when already completed
+     */
+    template <typename... V>
+    void setValue(V&&... value)
+    {
+        state->setValue(std::forward<V>(value)...);
+    }
+
+    void setException(std::exception_ptr error)
+    {
+        state->setException(error);
+    }
+
+private:
+    void abandon() noexcept
+    {
+        if (state && !state->isReady()) {
+            try {
+                state->setException(std::make_exception_ptr(std::future_error(std::future_errc::broken_promise)));
+            }
+            catch (...) {
+            }
+        }
+        state = nullptr;
+    }
+
+    std::shared_ptr<State> state;
+};
+
+/**
+ * @brief Future which already holds value
+ */
+template <typename T>
+Future<std::decay_t<T>> makeReadyFuture(T&& value)
+{
+    Promise<std::decay_t<T>> promise;
+    auto future = promise.getFuture();
+    promise.setValue(std::forward<T>(value));
+    return future;
+}
+
+inline Future<void> makeReadyFuture()
+{
+    Promise<void> promise;
+    auto future = promise.getFuture();
+    promise.setValue();
+    return future;
+}
+
+/**
+ * @brief Run function with arguments on the pool, continuations of the result run there too
+ */
+template <typename F, typename... Args>
+auto submit(ThreadPool& pool, F&& fun, Args&&... args)
+{
+    using Result = std::invoke_result_t<std::decay_t<F>&, std::decay_t<Args>&...>;
+    using Value = typename detail::Flatten<Result>::type;
+
+    Promise<Value> promise;
+    auto future = promise.getFuture(&pool);
+    pool.post([promise = std::move(promise), fun = std::forward<F>(fun),
+               arguments = std::make_tuple(std::forward<Args>(args)...)]() mutable {
+        detail::Continuation::fulfil<Result>(promise, [&]() -> Result { return std::apply(fun, arguments); });
+    });
+    return future;
+}
+
+/**
+ * @brief Future ready once all futures are ready
+ *
+ * Returned futures are all ready, failures are reported by their get().
+ * Continuations run on the executor of the first future which has one.
+ */
+template <typename T>
+Future<std::vector<Future<T>>> whenAll(std::vector<Future<T>> futures)
+{
+    struct Context {
+        std::atomic_size_t remaining;
+        std::vector<Future<T>> futures;
+        Promise<std::vector<Future<T>>> promise;
+    };
+
+    ThreadPool* pool = nullptr;
+    std::vector<std::shared_ptr<detail::FutureState<T>>> states;
+    for (auto& future : futures) {
+        if (pool == nullptr)
+            pool = future.executor();
+        states.push_back(detail::Continuation::state(future));
+    }
+
+    auto context = std::make_shared<Context>();
+    auto result = context->promise.getFuture(pool);
+    if (futures.empty()) {
+        context->promise.setValue();
+        return result;
+    }
+
+    context->remaining = futures.size();
+    context->futures = std::move(futures);
+    // callbacks may run right away, so they are attached to the collected states only
+    for (auto& state : states) {
+        state->onReady([context]() {
+            if (--context->remaining == 0)
+                context->promise.setValue(std::move(context->futures));
+        });
+    }
+    return result;
+}
+
+template <typename T>
+struct WhenAnyResult {
+    // position of the first future which became ready
+    size_t index;
+    std::vector<Future<T>> futures;
+};
+
+/**
+ * @brief Future ready once any of the futures is ready
+ *
+ * Empty input gives ready result with index equal to zero and no futures.
+ */
+template <typename T>
+Future<WhenAnyResult<T>> whenAny(std::vector<Future<T>> futures)
+{
+    struct Context {
+        std::atomic_bool done{false};
+        std::vector<Future<T>> futures;
+        Promise<WhenAnyResult<T>> promise;
+    };
+
+    ThreadPool* pool = nullptr;
+    std::vector<std::shared_ptr<detail::FutureState<T>>> states;
+    for (auto& future : futures) {
+        if (pool == nullptr)
+            pool = future.executor();
+        states.push_back(detail::Continuation::state(future));
+    }
+
+    auto context = std::make_shared<Context>();
+    auto result = context->promise.getFuture(pool);
+    if (futures.empty()) {
+        context->promise.setValue(WhenAnyResult<T>{0, {}});
+        return result;
+    }
+
+    context->futures = std::move(futures);
+    for (size_t i = 0; i < states.size(); ++i) {
+        states[i]->onReady([context, i]() {
+            if (!context->done.exchange(true))
+                context->promise.setValue(WhenAnyResult<T>{i, std::move(context->futures)});
+        });
+    }
+    return result;
+}
+} // namespace Simple
+
+#endif /* ifndef SIMPLE_FUTURE_HPP */
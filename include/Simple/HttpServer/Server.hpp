@@ -8,6 +8,11 @@
 #include <boost/asio.hpp>
 #include <boost/asio/signal_set.hpp>
 
+#ifdef __cpp_impl_coroutine
+#include <coroutine>
+#endif
+
+#include "../Affinity.hpp"
 #include "LoggingHelper.hpp"
 #include "Session.hpp"
 
@@ -30,16 +35,52 @@ class Server {
     };
 
     size_t threads_;
+    std::vector<unsigned> cpuOrder_;
     boost::asio::io_context ioc_;
     Listener listener_;
     Callbacks callbacks_;
 
 public:
     explicit Server(const std::string& address, unsigned short port, int threads = 0);
+
+    /**
+     * @brief Server with io threads pinned to CPUs
+     *
+     * @param cpus CPUs the threads may be pinned to, empty means all CPUs of the process
+     */
+    Server(const std::string& address, unsigned short port, int threads, Placement placement,
+           const std::vector<unsigned>& cpus = {});
     void start();
     void onRequest(RequestCallback callback);
     void onMessage(Connection::MessageCallback callback);
     void onConnection(Connection::StateCallback callback);
+
+#ifdef __cpp_impl_coroutine
+    /**
+     * @brief Awaitable which resumes the awaiting coroutine on one of the io threads
+     */
+    auto schedule()
+    {
+        struct Awaiter {
+            boost::asio::io_context& ioc;
+
+            bool await_ready() const noexcept
+            {
+                return false;
+            }
+
+            void await_suspend(std::coroutine_handle<> handle)
+            {
+                boost::asio::post(ioc, [handle]() { handle.resume(); });
+            }
+
+            void await_resume() const noexcept
+            {
+            }
+        };
+        return Awaiter{ioc_};
+    }
+#endif
 };
 } // namespace Simple::Http
 
@@ -0,0 +1,188 @@
+#ifndef SIMPLE_LATENCY_HISTOGRAM_HPP
+#define SIMPLE_LATENCY_HISTOGRAM_HPP
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#if (__cplusplus >= 202002L) || (defined(_MSVC_LANG) && _MSVC_LANG >= 202002L)
+#include <bit>
+#endif
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+#include <intrin.h>
+#endif
+
+namespace Simple {
+
+/**
+ * @brief Histogram of durations with log-linear buckets
+ *
+ * Every power of two range is split into SubBuckets equal buckets, like
+ * HdrHistogram does, so any recorded value is reported with relative
+ * error below 1/SubBuckets regardless of its magnitude. Values are
+ * nanoseconds.
+ */
+class LatencyHistogram {
+public:
+    static constexpr unsigned SubBucketBits = 4;
+    static constexpr uint64_t SubBuckets = uint64_t{1} << SubBucketBits;
+    static constexpr size_t BucketCount = (64 - SubBucketBits + 1) * SubBuckets;
+
+    static size_t bucketOf(uint64_t value)
+    {
+        if (value < SubBuckets)
+            return static_cast<size_t>(value);
+        unsigned msb = highestBit(value);
+        unsigned shift = msb - SubBucketBits;
+        return (shift + 1) * SubBuckets + static_cast<size_t>((value >> shift) & (SubBuckets - 1));
+    }
+
+    // index of the highest set bit, value is not zero
+    static unsigned highestBit(uint64_t value)
+    {
+#if defined(__cpp_lib_bitops)
+        return 63 - static_cast<unsigned>(std::countl_zero(value));
+#elif defined(__GNUC__) || defined(__clang__)
+        return 63 - static_cast<unsigned>(__builtin_clzll(value));
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+        unsigned long index;
+        _BitScanReverse64(&index, value);
+        return static_cast<unsigned>(index);
+#else
+        unsigned bit = 0;
+        while (value >>= 1) {
+            ++bit;
+        }
+        return bit;
+#endif
+    }
+
+    // highest value which falls into bucket
+    static uint64_t upperBound(size_t bucket)
+    {
+        if (bucket < SubBuckets)
+            return bucket;
+        unsigned shift = static_cast<unsigned>(bucket / SubBuckets) - 1;
+        uint64_t base = (SubBuckets + bucket % SubBuckets) << shift;
+        return base + ((uint64_t{1} << shift) - 1);
+    }
+
+    void record(uint64_t value)
+    {
+        ++buckets[bucketOf(value)];
+        ++total;
+        sum += value;
+        maximum = std::max(maximum, value);
+    }
+
+    void record(std::chrono::nanoseconds value)
+    {
+        record(static_cast<uint64_t>(std::max<std::chrono::nanoseconds::rep>(value.count(), 0)));
+    }
+
+    void merge(const LatencyHistogram& other)
+    {
+        for (size_t i = 0; i < BucketCount; ++i) {
+            buckets[i] += other.buckets[i];
+        }
+        total += other.total;
+        sum += other.sum;
+        maximum = std::max(maximum, other.maximum);
+    }
+
+    uint64_t count() const
+    {
+        return total;
+    }
+
+    uint64_t max() const
+    {
+        return maximum;
+    }
+
+    double mean() const
+    {
+        return total == 0 ? 0.0 : static_cast<double>(sum) / static_cast<double>(total);
+    }
+
+    /**
+     * @brief Smallest value which is not exceeded by given fraction of records
+     *
+     * @param fraction between 0 and 1, e.g. 0.99 for p99
+     */
+    uint64_t percentile(double fraction) const
+    {
+        if (total == 0)
+            return 0;
+        auto rank = static_cast<uint64_t>(std::max(fraction, 0.0) * static_cast<double>(total));
+        rank = std::min(std::max<uint64_t>(rank, 1), total);
+
+        uint64_t seen = 0;
+        for (size_t i = 0; i < BucketCount; ++i) {
+            seen += buckets[i];
+            if (seen >= rank)
+                return std::min(upperBound(i), maximum);
+        }
+        return maximum;
+    }
+
+    uint64_t bucket(size_t index) const
+    {
+        return buckets[index];
+    }
+
+private:
+    friend class ConcurrentHistogram;
+
+    std::array<uint64_t, BucketCount> buckets{};
+    uint64_t total = 0;
+    uint64_t sum = 0;
+    uint64_t maximum = 0;
+};
+
+/**
+ * @brief LatencyHistogram written by one thread and read by any
+ *
+ * Recording is a handful of relaxed loads and stores, no locked
+ * instruction, so it is cheap enough for every task. addTo() may run
+ * concurrently and returns slightly torn but usable numbers.
+ */
+class ConcurrentHistogram {
+public:
+    void record(std::chrono::nanoseconds value)
+    {
+        auto v = static_cast<uint64_t>(std::max<std::chrono::nanoseconds::rep>(value.count(), 0));
+        bump(buckets[LatencyHistogram::bucketOf(v)], 1);
+        bump(total, 1);
+        bump(sum, v);
+        if (v > maximum.load(std::memory_order_relaxed))
+            maximum.store(v, std::memory_order_relaxed);
+    }
+
+    void addTo(LatencyHistogram& histogram) const
+    {
+        for (size_t i = 0; i < LatencyHistogram::BucketCount; ++i) {
+            histogram.buckets[i] += buckets[i].load(std::memory_order_relaxed);
+        }
+        histogram.total += total.load(std::memory_order_relaxed);
+        histogram.sum += sum.load(std::memory_order_relaxed);
+        histogram.maximum = std::max(histogram.maximum, maximum.load(std::memory_order_relaxed));
+    }
+
+    // only the owning thread writes, so no read-modify-write is needed
+    static void bump(std::atomic<uint64_t>& counter, uint64_t value)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+
+private:
+    std::array<std::atomic<uint64_t>, LatencyHistogram::BucketCount> buckets{};
+    std::atomic<uint64_t> total{0};
+    std::atomic<uint64_t> sum{0};
+    std::atomic<uint64_t> maximum{0};
+};
+} // namespace Simple
+
+#endif /* ifndef SIMPLE_LATENCY_HISTOGRAM_HPP */
@@ -11,6 +11,10 @@
 #endif
 #include <windows.h>
 
+#include <fcntl.h>
+#include <io.h>
+#include <sys/stat.h>
+
 #if (_MSC_VER >= 1700)
 #include <mutex>
 #else
@@ -25,7 +29,12 @@
 
 #else
 // Linux and friends
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <sys/time.h>
+#include <sys/uio.h>
+#include <unistd.h>
 #if (__cplusplus > 201402L)
 #include <experimental/filesystem>
 #include <mutex>
@@ -35,14 +44,47 @@
 #endif
 #endif
 
+#include <algorithm>
 #include <array>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstdint>
 #include <cstdio>
+#include <cstring>
 #include <ctime>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <limits>
+#include <map>
+#include <memory>
 #include <sstream>
 #include <string>
+#include <type_traits>
+#include <vector>
+
+#if (__cplusplus >= 201703L) || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L)
+#include <charconv>
+#include <string_view>
+#endif
+
+#if (__cplusplus >= 201703L) || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L)
+#define SIMPLE_LOGGER_ASYNC
+#include <condition_variable>
+#include <csignal>
+#include <deque>
+#include <iterator>
+#include <thread>
+
+#include "ConditionBuffer.hpp"
+
+// compressed rotated segments, the program links zlib
+#ifdef SIMPLE_LOGGER_ZLIB
+#include <zlib.h>
+#endif
+#endif
 
 namespace Simple {
 
@@ -64,204 +106,2123 @@ struct LogLevel {
     enum { Error, Warning, Info, Debug, Trace };
 };
 
+namespace detail {
+// the level every LOG statement reads, a template so that the header defines it once
+template <typename T = void>
+struct RuntimeLevel {
+    static std::atomic<int> value;
+};
+
+template <typename T>
+std::atomic<int> RuntimeLevel<T>::value{LogLevel::Info};
+} // namespace detail
+
+/**
+ * @brief Level of the LOG_MODULE statements of one call site
+ *
+ * Logger keeps the level up to date when the reporting level or an override
+ * of the module changes, the statement only reads it.
+ */
+class LogModuleSite {
+public:
+    explicit LogModuleSite(const char* module);
+
+    int level() const
+    {
+        return level_.load(std::memory_order_relaxed);
+    }
+
+    const char* module() const
+    {
+        return module_;
+    }
+
+private:
+    friend class Logger;
+
+    const char* module_;
+    std::atomic<int> level_{LogLevel::Info};
+};
+
 inline std::string NowTime();
+// writes the time prefix of a log line to buffer, which has room for 32 characters
+inline std::size_t formatNowTime(char* buffer);
+// the same, with the time read in microseconds since the epoch
+inline std::size_t formatNowTime(char* buffer, std::uint64_t& microseconds);
 
-class Logger {
+/**
+ * @brief Characters of one log line, kept inline and moved to the heap only when the line gets long
+ */
+class LogBuffer {
 public:
-    static Logger* getInstance()
+    static constexpr std::size_t InlineSize = 256;
+
+    LogBuffer() = default;
+
+    explicit LogBuffer(const std::string& text)
     {
-        static Logger instance;
-        return &instance;
-    };
+        append(text.data(), text.size());
+    }
 
-    static int levelFromString(std::string level)
+    LogBuffer(const LogBuffer& other)
     {
-        if (level == "Debug")
-            return LogLevel::Debug;
-        if (level == "Warning")
-            return LogLevel::Warning;
-        if (level == "Trace")
-            return LogLevel::Trace;
-        if (level == "Info")
-            return LogLevel::Info;
-        if (level == "Error")
-            return LogLevel::Error;
-        return LogLevel::Info;
+        append(other.data(), other.size());
     }
 
-    void writeStream(std::string&& logLine)
+    LogBuffer(LogBuffer&& other) noexcept
+        : length(other.length)
+        , onHeap(other.onHeap)
+        , heap(std::move(other.heap))
     {
-        LockType lock(mtx);
-        if (logToFile) {
-            if (openTimeIsDifferent())
-                openFile();
-            file << logLine << std::endl;
+        if (!onHeap)
+            std::memcpy(inlineData, other.inlineData, length);
+        other.clear();
+    }
+
+    LogBuffer& operator=(const LogBuffer& other)
+    {
+        if (this != &other) {
+            clear();
+            append(other.data(), other.size());
         }
-        else {
-            std::cerr << logLine << std::endl;
+        return *this;
+    }
+
+    LogBuffer& operator=(LogBuffer&& other) noexcept
+    {
+        if (this != &other) {
+            length = other.length;
+            onHeap = other.onHeap;
+            heap = std::move(other.heap);
+            if (!onHeap)
+                std::memcpy(inlineData, other.inlineData, length);
+            other.clear();
         }
+        return *this;
     }
 
-    int& reportingLevel()
+    void append(const char* text, std::size_t count)
     {
-        return reportingLevel_;
+        if (!onHeap) {
+            if (length + count <= InlineSize) {
+                std::memcpy(inlineData + length, text, count);
+                length += count;
+                return;
+            }
+            heap.assign(inlineData, length);
+            onHeap = true;
+        }
+        heap.append(text, count);
     }
 
-    void setFileName(std::string dir, std::string name)
+    void append(char c)
     {
-        LockType lock(mtx);
-        logsDir = dir;
-        logsName = name;
-        logToFile = true;
-        openFile();
+        append(&c, 1);
+    }
+
+    const char* data() const
+    {
+        return onHeap ? heap.data() : inlineData;
+    }
+
+    std::size_t size() const
+    {
+        return onHeap ? heap.size() : length;
+    }
+
+    void clear()
+    {
+        length = 0;
+        onHeap = false;
+        heap.clear();
+    }
+
+    // drops what was appended after the buffer had size characters
+    void truncate(std::size_t size)
+    {
+        if (onHeap)
+            heap.resize(size);
+        else
+            length = size;
     }
 
 private:
-    Logger()
-        : reportingLevel_(LogLevel::Info)
-        , logToFile(false){};
-    Logger(Logger const&){};
-    void operator=(Logger const&){};
+    char inlineData[InlineSize];
+    std::size_t length = 0;
+    bool onHeap = false;
+    std::string heap;
+};
 
-    bool openTimeIsDifferent()
+/**
+ * @brief Piece of a log line handed to LogFile::write
+ */
+struct LogSpan {
+    const char* data;
+    std::size_t size;
+};
+
+/**
+ * @brief Log file opened for appending, written straight with write/writev and no buffer of its own
+ *
+ * The spans of one call go out in a single system call as far as the OS allows.
+ *
+ * Opened with a map chunk, the file is instead written through a shared
+ * memory mapping: appending is a memcpy, the page cache writes the pages
+ * back and keeps them when the process crashes. The file grows and the
+ * mapping moves mapChunk bytes at a time, close syncs the mapping and cuts
+ * the file back to what was written. A file left longer by a crash ends in
+ * zeros, which open skips. Windows always writes with _write.
+ */
+class LogFile {
+public:
+    LogFile() = default;
+    LogFile(const LogFile&) = delete;
+    LogFile& operator=(const LogFile&) = delete;
+
+    LogFile(LogFile&& other) noexcept
     {
-        const auto t = std::time(nullptr);
-        tm now;
-        tm last;
+        take(other);
+    }
+
+    LogFile& operator=(LogFile&& other) noexcept
+    {
+        if (this != &other) {
+            close();
+            take(other);
+        }
+        return *this;
+    }
+
+    ~LogFile()
+    {
+        close();
+    }
+
+    bool open(const std::string& path, std::size_t mapChunk = 0)
+    {
+        close();
+#ifdef WIN32
+        (void)mapChunk;
+        fd = _open(path.c_str(), _O_WRONLY | _O_CREAT | _O_APPEND | _O_BINARY, _S_IREAD | _S_IWRITE);
+        if (fd < 0)
+            return false;
+        length = static_cast<std::uint64_t>(_filelengthi64(fd));
+#else
+        if (mapChunk > 0) {
+            fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+            auto page = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+            chunk = (mapChunk + page - 1) / page * page;
+        }
+        else {
+            fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        }
+        struct stat status;
+        if (fd < 0 || fstat(fd, &status) != 0) {
+            close();
+            return false;
+        }
+        length = fileLength = static_cast<std::uint64_t>(status.st_size);
+        if (chunk > 0)
+            skipZeros();
+#endif
+        return true;
+    }
+
+    void close()
+    {
+        if (fd >= 0) {
 #ifdef WIN32
-        localtime_s(&now, &t);
-        localtime_s(&last, &lastOpenTime);
+            _close(fd);
 #else
-        now = *std::localtime(&t);
-        last = *std::localtime(&lastOpenTime);
+            if (map != nullptr) {
+                msync(map, mapLength, MS_SYNC);
+                munmap(map, mapLength);
+            }
+            if (fileLength > length && ftruncate(fd, static_cast<off_t>(length)) != 0)
+                std::cerr << "Cannot cut the log file back to " << length << " bytes" << std::endl;
+            ::close(fd);
+#endif
+            fd = -1;
+        }
+        // also after a failed open, which may have set the chunk already
+#ifndef WIN32
+        chunk = 0;
+        map = nullptr;
+        mapBegin = 0;
+        mapLength = 0;
+        fileLength = 0;
 #endif
+        length = 0;
+    }
 
-        bool dateDiffer = (now.tm_year != last.tm_year || now.tm_mon != last.tm_mon || now.tm_mday != last.tm_mday);
-        return dateDiffer;
+    bool isOpen() const
+    {
+        return fd >= 0;
+    }
+
+    // bytes in the file, without the part a mapping reserved ahead
+    std::uint64_t size() const
+    {
+        return length;
     }
 
-    void openFile()
+    void write(const char* data, std::size_t size)
     {
-        if (file.is_open()) {
-            file.close();
+        LogSpan span{data, size};
+        write(&span, 1);
+    }
+
+    // no allocation and no new mapping, a mapped file only takes what fits into its current window
+    void writeFromSignal(const char* data, std::size_t size)
+    {
+#ifndef WIN32
+        if (chunk > 0) {
+            if (map == nullptr || length + size > mapBegin + mapLength)
+                return;
+            std::memcpy(map + (length - mapBegin), data, size);
+            length += size;
+            return;
         }
+#endif
+        write(data, size);
+    }
 
-        lastOpenTime = std::time(nullptr);
-        tm td;
+    // a failed write drops the rest, a logger has nowhere to report it
+    void write(const LogSpan* spans, std::size_t count)
+    {
+        if (fd < 0)
+            return;
 #ifdef WIN32
-        localtime_s(&td, &lastOpenTime);
-#else
-        td = *std::localtime(&lastOpenTime);
-#endif
-        std::stringstream ss;
-        if (!logsDir.empty()) {
-            try {
-                if (!fs::exists(logsDir))
-                    fs::create_directories(logsDir);
+        for (std::size_t i = 0; i < count; ++i) {
+            const char* data = spans[i].data;
+            std::size_t left = spans[i].size;
+            while (left > 0) {
+                int written = _write(fd, data, static_cast<unsigned>(std::min<std::size_t>(left, INT_MAX)));
+                if (written <= 0)
+                    return;
+                data += written;
+                left -= static_cast<std::size_t>(written);
+                length += static_cast<std::uint64_t>(written);
             }
-            catch (...) {
-                std::cerr << "Cannot create directory: " << logsDir << std::endl;
+        }
+#else
+        if (chunk > 0) {
+            writeMapped(spans, count);
+            return;
+        }
+        iovec vectors[MaxVectors];
+        while (count > 0) {
+            std::size_t batch = count < MaxVectors ? count : MaxVectors;
+            for (std::size_t i = 0; i < batch; ++i) {
+                vectors[i].iov_base = const_cast<char*>(spans[i].data);
+                vectors[i].iov_len = spans[i].size;
             }
-            ss << logsDir << "/";
+            if (!writeAll(vectors, static_cast<int>(batch)))
+                return;
+            spans += batch;
+            count -= batch;
         }
-        ss << logsName << "_" << (td.tm_year + 1900) << "-" << std::setw(2) << std::setfill('0') << td.tm_mon + 1 << "-"
-           << std::setw(2) << std::setfill('0') << td.tm_mday << ".log";
-        std::cerr << "Opening log file: " << ss.str() << std::endl;
-        file.open(ss.str(), std::ios::app);
+#endif
     }
 
-    int reportingLevel_;
-    bool logToFile;
-    time_t lastOpenTime;
-    MutexType mtx;
-    std::string logsName;
-    std::string logsDir;
-    std::ofstream file;
-};
+private:
+    void take(LogFile& other)
+    {
+        fd = other.fd;
+        length = other.length;
+        other.fd = -1;
+#ifndef WIN32
+        chunk = other.chunk;
+        map = other.map;
+        mapBegin = other.mapBegin;
+        mapLength = other.mapLength;
+        fileLength = other.fileLength;
+        other.chunk = 0;
+        other.map = nullptr;
+#endif
+    }
 
-class LogLine {
-public:
-    explicit LogLine(int level)
+#ifndef WIN32
+#ifdef IOV_MAX
+    static constexpr std::size_t MaxVectors = IOV_MAX < 1024 ? IOV_MAX : 1024;
+#else
+    static constexpr std::size_t MaxVectors = 16;
+#endif
+
+    bool writeAll(iovec* vectors, int count)
     {
-        os_ << NowTime();
-        os_ << " " << std::setw(9) << levelToString(level) + ": ";
+        while (count > 0) {
+            if (vectors->iov_len == 0) {
+                ++vectors;
+                --count;
+                continue;
+            }
+            auto written = ::writev(fd, vectors, count);
+            if (written < 0) {
+                if (errno == EINTR)
+                    continue;
+                return false;
+            }
+            // a partial write may stop inside a vector
+            auto left = static_cast<std::size_t>(written);
+            length += left;
+            while (count > 0 && left >= vectors->iov_len) {
+                left -= vectors->iov_len;
+                ++vectors;
+                --count;
+            }
+            if (count > 0) {
+                vectors->iov_base = static_cast<char*>(vectors->iov_base) + left;
+                vectors->iov_len -= left;
+            }
+        }
+        return true;
     }
 
-    template <class T>
-    LogLine& operator<<(T&& arg)
+    void writeMapped(const LogSpan* spans, std::size_t count)
     {
-        os_ << std::forward<T>(arg);
-        return *this;
+        std::size_t total = 0;
+        for (std::size_t i = 0; i < count; ++i) {
+            total += spans[i].size;
+        }
+        if (!reserve(total))
+            return;
+        char* out = map + (length - mapBegin);
+        for (std::size_t i = 0; i < count; ++i) {
+            std::memcpy(out, spans[i].data, spans[i].size);
+            out += spans[i].size;
+        }
+        length += total;
     }
 
-    ~LogLine()
+    // maps a window from the page holding the end of the file, growing the file when the window passes it
+    bool reserve(std::size_t size)
     {
-        Simple::Logger::getInstance()->writeStream(os_.str());
+        if (map != nullptr && length + size <= mapBegin + mapLength)
+            return true;
+        if (map != nullptr) {
+            munmap(map, mapLength);
+            map = nullptr;
+        }
+
+        auto page = static_cast<std::uint64_t>(sysconf(_SC_PAGESIZE));
+        auto begin = length / page * page;
+        auto needed = (length - begin + size + page - 1) / page * page;
+        auto windowLength = static_cast<std::size_t>(needed > chunk ? needed : chunk);
+        if (begin + windowLength > fileLength) {
+            if (ftruncate(fd, static_cast<off_t>(begin + windowLength)) != 0)
+                return false;
+            fileLength = begin + windowLength;
+        }
+        void* window = mmap(nullptr, windowLength, PROT_READ | PROT_WRITE, MAP_SHARED, fd, static_cast<off_t>(begin));
+        if (window == MAP_FAILED)
+            return false;
+        map = static_cast<char*>(window);
+        mapBegin = begin;
+        mapLength = windowLength;
+        return true;
     }
 
-private:
-    const std::string& levelToString(int level)
+    // the lines end before the zeros a mapping left behind when the process died
+    void skipZeros()
     {
-        static const std::array<std::string, 5> levels = {"ERROR", "WARNING", "INFO", "DEBUG", "TRACE"};
-        return levels[level];
+        char block[4096];
+        while (length > 0) {
+            auto blockLength = length < sizeof(block) ? static_cast<std::size_t>(length) : sizeof(block);
+            auto read = pread(fd, block, blockLength, static_cast<off_t>(length - blockLength));
+            if (read != static_cast<ssize_t>(blockLength))
+                return;
+            auto end = blockLength;
+            while (end > 0 && block[end - 1] == '\0') {
+                --end;
+            }
+            length -= blockLength - end;
+            if (end > 0)
+                return;
+        }
     }
 
-    std::ostringstream os_;
+    std::size_t chunk = 0;
+    char* map = nullptr;
+    std::uint64_t mapBegin = 0;
+    std::size_t mapLength = 0;
+    std::uint64_t fileLength = 0;
+#endif
+
+    int fd = -1;
+    std::uint64_t length = 0;
 };
 
-#if defined(WIN32) || defined(_WIN32) || defined(__WIN32__)
-inline std::string NowTime()
+namespace detail {
+
+// separator and level name of a line, right aligned the way std::setw(9) did it
+inline const char* levelPrefix(int level)
 {
-    const int MAX_LEN = 200;
-    char buffer[MAX_LEN];
-    if (GetTimeFormatA(LOCALE_USER_DEFAULT, 0, 0, "HH':'mm':'ss", buffer, MAX_LEN) == 0)
-        return "Error in NowTime()";
-
-    char dateBuffer[MAX_LEN];
-    if (GetDateFormatA(LOCALE_USER_DEFAULT, 0, 0, "dd'.'MM'.'yyyy", dateBuffer, MAX_LEN) == 0)
-        return "Error in NowTime()";
-
-    char result[100] = {0};
-    static DWORD first = GetTickCount();
-    sprintf_s(result, "%s %s.%03ld", dateBuffer, buffer, (long)(GetTickCount() - first) % 1000);
-    return result;
+    static const std::array<const char*, 5> levels = {
+        "   ERROR: ", " WARNING: ", "    INFO: ", "   DEBUG: ", "   TRACE: "};
+    return levels[level];
 }
-#else
-inline std::string NowTime()
+
+// room for any integer, sign included
+constexpr std::size_t IntegerDigits = 24;
+
+// fills the digits backwards from end, two at a time
+inline char* formatUnsigned(char* end, unsigned long long value)
 {
-    char buffer[50];
-    time_t t = time(nullptr);
-    tm r;
-    localtime_r(&t, &r);
-    strftime(buffer, sizeof(buffer), "%F %H:%M:%S", &r);
-    struct timeval tv;
-    gettimeofday(&tv, 0);
-    char result[100] = {0};
-    sprintf(result, "%s.%03ld", buffer, (long)tv.tv_usec / 1000);
-    return result;
+    static const char pairs[] = "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+                                "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+                                "8081828384858687888990919293949596979899";
+    while (value >= 100) {
+        auto pair = static_cast<std::size_t>(value % 100) * 2;
+        value /= 100;
+        *--end = pairs[pair + 1];
+        *--end = pairs[pair];
+    }
+    if (value >= 10) {
+        auto pair = static_cast<std::size_t>(value) * 2;
+        *--end = pairs[pair + 1];
+        *--end = pairs[pair];
+    }
+    else {
+        *--end = static_cast<char>('0' + value);
+    }
+    return end;
 }
-#endif // WIN32
 
-} // namespace Simple
+template <class T>
+char* formatInteger(char* end, T value, std::true_type /*isSigned*/)
+{
+    if (value >= 0)
+        return formatUnsigned(end, static_cast<unsigned long long>(value));
+    // negating the unsigned value keeps the minimum of T representable
+    end = formatUnsigned(end, 0ULL - static_cast<unsigned long long>(value));
+    *--end = '-';
+    return end;
+}
 
-#define LOG(level)                                                                                                     \
-    if (level > Simple::Logger::getInstance()->reportingLevel())                                                       \
-        ;                                                                                                              \
-    else                                                                                                               \
-        Simple::LogLine(level)
+template <class T>
+char* formatInteger(char* end, T value, std::false_type /*isSigned*/)
+{
+    return formatUnsigned(end, static_cast<unsigned long long>(value));
+}
 
-#define LOG_INFO LOG(Simple::LogLevel::Info)
+// same output as an ostream with default flags, shortest %g with 6 significant digits
+template <class T>
+std::size_t formatFloating(char* buffer, std::size_t size, T value)
+{
+#if defined(__cpp_lib_to_chars)
+    return static_cast<std::size_t>(std::to_chars(buffer, buffer + size, value, std::chars_format::general, 6).ptr - buffer);
+#else
+    int written = std::is_same<T, long double>::value
+                      ? std::snprintf(buffer, size, "%Lg", static_cast<long double>(value))
+                      : std::snprintf(buffer, size, "%g", static_cast<double>(value));
+    return written < 0 ? 0 : std::min(static_cast<std::size_t>(written), size - 1);
+#endif
+}
 
-#define LOG_WARNING LOG(Simple::LogLevel::Warning)
+// streambuf appending to the LogBuffer of the line being formatted
+class LogStreamBuf : public std::streambuf {
+public:
+    LogBuffer* target = nullptr;
 
-#define LOG_DEBUG LOG(Simple::LogLevel::Debug)
+protected:
+    int_type overflow(int_type c) override
+    {
+        if (!traits_type::eq_int_type(c, traits_type::eof()))
+            target->append(traits_type::to_char_type(c));
+        return traits_type::not_eof(c);
+    }
 
-#define LOG_TRACE LOG(Simple::LogLevel::Trace)
+    std::streamsize xsputn(const char* text, std::streamsize count) override
+    {
+        target->append(text, static_cast<std::size_t>(count));
+        return count;
+    }
+};
 
-#define LOG_ERROR LOG(Simple::LogLevel::Error)
+/**
+ * @brief Formats values without a fast path through their operator<<, straight into a LogBuffer
+ */
+class LogStream : public std::ostream {
+public:
+    LogStream()
+        : std::ostream(&streamBuf)
+    {
+    }
 
-#define LOG_REPORTING_LEVEL(level)                                                                                     \
-    Simple::Logger::getInstance()->reportingLevel() = Simple::Logger::levelFromString(level)
+    void attach(LogBuffer& buffer)
+    {
+        streamBuf.target = &buffer;
+        // a line starts with the formatting state of a fresh ostream
+        clear();
+        flags(std::ios_base::skipws | std::ios_base::dec);
+        width(0);
+        precision(6);
+        fill(' ');
+    }
+
+    void detach()
+    {
+        streamBuf.target = nullptr;
+    }
+
+    bool attached() const
+    {
+        return streamBuf.target != nullptr;
+    }
+
+private:
+    LogStreamBuf streamBuf;
+};
+
+} // namespace detail
+
+#ifdef SIMPLE_LOGGER_ASYNC
+/**
+ * @brief What a logging thread does when the async queue is full
+ */
+enum class LogOverflow {
+    // wait for the writer thread, no line is lost
+    Block,
+    // throw the line away, see Logger::droppedLines()
+    Drop,
+    // throw the line away, the writer logs how many lines were lost
+    DropAndReport
+};
+
+struct AsyncLogOptions {
+    LogOverflow overflow = LogOverflow::Block;
+    // longest time a written line stays in the stream buffer while lines keep coming
+    std::chrono::milliseconds flushInterval{200};
+    // write queued lines before the process dies on a crash signal, the previous handlers run afterwards
+    bool flushOnSignal = false;
+    // SIGTERM as well, only for programs which do not install their own handler later
+    bool flushOnTerminate = false;
+};
+
+/**
+ * @brief When Logger starts a new file segment besides the new file every day
+ *
+ * Segments of a day are name_date.log, name_date.1.log, name_date.2.log and so on.
+ */
+struct LogRotation {
+    // bytes of a segment, 0 for no limit
+    std::uint64_t maxBytes = 0;
+    // lines of a segment, 0 for no limit
+    std::uint64_t maxLines = 0;
+    // closed segments kept besides the current one, older ones are deleted, 0 keeps all
+    std::size_t maxFiles = 0;
+    // gzip closed segments to name_date.N.log.gz, needs SIMPLE_LOGGER_ZLIB
+#ifdef SIMPLE_LOGGER_ZLIB
+    bool compress = true;
+#else
+    bool compress = false;
+#endif
+};
+
+struct BufferedLogOptions {
+    // longest time a line waits in the buffer of its thread
+    std::chrono::milliseconds flushInterval{200};
+    // a thread which collected this many bytes writes the buffers of all threads
+    std::size_t flushBytes = 64 * 1024;
+};
+#endif
+
+class LogRateSite;
+
+class Logger {
+public:
+    static Logger* getInstance()
+    {
+        static Logger instance;
+        return &instance;
+    };
+
+    static int levelFromString(std::string level)
+    {
+        if (level == "Debug")
+            return LogLevel::Debug;
+        if (level == "Warning")
+            return LogLevel::Warning;
+        if (level == "Trace")
+            return LogLevel::Trace;
+        if (level == "Info")
+            return LogLevel::Info;
+        if (level == "Error")
+            return LogLevel::Error;
+        return LogLevel::Info;
+    }
+
+    // time is when the line was formatted in microseconds since the epoch, 0 for now
+    void writeStream(LogBuffer&& logLine, std::uint64_t time = 0)
+    {
+#ifdef SIMPLE_LOGGER_ASYNC
+        if (buffered.load(std::memory_order_acquire) && appendBuffered(logLine, time))
+            return;
+        if (async.load(std::memory_order_acquire) && enqueue(std::move(logLine)))
+            return;
+#else
+        (void)time;
+#endif
+        logLine.append('\n');
+        LogSpan span{logLine.data(), logLine.size()};
+        LockType lock(mtx);
+        writeSpans(&span, 1, 1);
+    }
+
+    void writeStream(std::string&& logLine)
+    {
+        writeStream(LogBuffer(logLine));
+    }
+
+    /**
+     * @brief The reporting level, as LOG statements read it
+     */
+    static int currentLevel()
+    {
+        return detail::RuntimeLevel<>::value.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Reads like the int the level used to be, assigning to it calls setReportingLevel
+     */
+    class LevelReference {
+    public:
+        explicit LevelReference(Logger& logger)
+            : logger(logger)
+        {
+        }
+
+        operator int() const
+        {
+            return Logger::currentLevel();
+        }
+
+        LevelReference& operator=(int level)
+        {
+            logger.setReportingLevel(level);
+            return *this;
+        }
+
+    private:
+        Logger& logger;
+    };
+
+    /**
+     * @brief Assignable reporting level, getInstance()->reportingLevel() = LogLevel::Debug still works
+     */
+    LevelReference reportingLevel()
+    {
+        return LevelReference{*this};
+    }
+
+    /**
+     * @brief Level of all statements, besides the ones of modules with their own level
+     */
+    void setReportingLevel(int level)
+    {
+        LockType lock(levelsMtx);
+        detail::RuntimeLevel<>::value.store(level, std::memory_order_relaxed);
+        for (auto* site : moduleSites) {
+            if (moduleLevels.find(site->module()) == moduleLevels.end())
+                site->level_.store(level, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * @brief Level of the LOG_MODULE statements of module, instead of the reporting level
+     */
+    void setModuleLevel(const std::string& module, int level)
+    {
+        LockType lock(levelsMtx);
+        moduleLevels[module] = level;
+        updateModuleSites(module);
+    }
+
+    /**
+     * @brief Writes how many lines every LOG_EVERY_N, LOG_FIRST_N and LOG_EVERY_MS statement
+     * suppressed since its last line or summary
+     */
+    void reportSuppressed();
+
+    /**
+     * @brief The statements of module follow the reporting level again
+     */
+    void resetModuleLevel(const std::string& module)
+    {
+        LockType lock(levelsMtx);
+        moduleLevels.erase(module);
+        updateModuleSites(module);
+    }
+
+    void setFileName(std::string dir, std::string name)
+    {
+        LockType lock(mtx);
+        logsDir = dir;
+        logsName = name;
+        logToFile = true;
+        // the file of the previous name is not a segment of the new one
+        file.close();
+        filePath.clear();
+        segmentDate.clear();
+        openFile();
+    }
+
+    /**
+     * @brief Write the log file through a memory mapping which grows chunkBytes at a time, 0 for write()
+     *
+     * Lines reach the page cache with a memcpy, so the ones logged before the
+     * process crashed are in the file without a flush per line. The current
+     * file is reopened the new way.
+     */
+    void setMappedFile(std::size_t chunkBytes)
+    {
+        LockType lock(mtx);
+        mapChunk = chunkBytes;
+        if (!logToFile)
+            return;
+        // the same segment again, nothing to hand over for compression
+        file.close();
+        filePath.clear();
+        openFile();
+    }
+
+#ifdef SIMPLE_LOGGER_ASYNC
+    /**
+     * @brief Hand lines over to a writer thread instead of writing on the caller's thread
+     *
+     * The writer takes lines in batches and flushes the stream when the
+     * queue runs empty or every flushInterval under load.
+     */
+    void startAsync(const AsyncLogOptions& options = AsyncLogOptions())
+    {
+        stopBuffered();
+        LockType lock(mtx);
+        if (async)
+            return;
+
+        overflow = options.overflow;
+        flushInterval = options.flushInterval;
+        if (!queue)
+            queue = std::make_unique<AsyncQueue>();
+        queue->enable();
+        {
+            std::lock_guard<std::mutex> lock{flushMtx};
+            written = queue->takeCount();
+        }
+        stopping = false;
+        writer = std::thread([this]() { writeQueued(); });
+        if (options.flushOnSignal)
+            installSignalHandlers(options.flushOnTerminate);
+        async.store(true, std::memory_order_release);
+    }
+
+    /**
+     * @brief Write remaining lines and go back to writing on the caller's thread
+     *
+     * Lines logged concurrently with the switch may be written out of order.
+     */
+    void stopAsync()
+    {
+        if (!async.exchange(false))
+            return;
+
+        stopping = true;
+        queue->disable();
+        writer.join();
+        {
+            std::lock_guard<std::mutex> lock{flushMtx};
+        }
+        flushedCv.notify_all();
+
+        // lines which slipped in after the writer left
+        LockType lock(mtx);
+        lockQueue();
+        LogBuffer logLine;
+        while (queue->tryGet(logLine)) {
+            writeLine(logLine);
+        }
+        unlockQueue();
+        flushStream();
+    }
+
+    /**
+     * @brief Wait until every line logged before the call reached the stream and got flushed
+     */
+    void flush()
+    {
+        if (buffered) {
+            flushBuffers();
+            return;
+        }
+        if (async) {
+            // the queue position behind the caller's own lines, the writer passes positions in order
+            uint64_t target = queue->putCount();
+            std::unique_lock<std::mutex> lock{flushMtx};
+            flushedCv.wait(lock, [&]() { return written >= target || !async; });
+            return;
+        }
+        LockType lock(mtx);
+        flushStream();
+    }
+
+    /**
+     * @brief Collect lines in a buffer per thread, no lock is shared between logging threads
+     *
+     * A flush takes the buffers of all threads, merges their lines by time
+     * and writes them with one writev. It happens every flushInterval and
+     * whenever a thread collected flushBytes.
+     */
+    void startBuffered(const BufferedLogOptions& options = BufferedLogOptions())
+    {
+        stopAsync();
+        std::lock_guard<std::mutex> lock{bufferedMtx};
+        if (buffered)
+            return;
+
+        flushBytes.store(options.flushBytes, std::memory_order_relaxed);
+        bufferFlushInterval = options.flushInterval;
+        stopFlusher = false;
+        flusher = std::thread([this]() { flushPeriodically(); });
+        buffered.store(true);
+    }
+
+    /**
+     * @brief Write the buffered lines and go back to writing on the caller's thread
+     */
+    void stopBuffered()
+    {
+        {
+            std::lock_guard<std::mutex> lock{bufferedMtx};
+            if (!buffered.exchange(false))
+                return;
+            stopFlusher = true;
+        }
+        flusherCv.notify_one();
+        flusher.join();
+        flushBuffers();
+    }
+
+    /**
+     * @brief Rotate the log file by size or line count
+     *
+     * The logging thread which crosses a limit only opens the next segment
+     * and swaps it in. Closing, compressing and deleting old segments
+     * happens on a background thread.
+     */
+    void setRotation(const LogRotation& options)
+    {
+#ifndef SIMPLE_LOGGER_ZLIB
+        if (options.compress)
+            std::cerr << "Log segments stay uncompressed, SIMPLE_LOGGER_ZLIB is not defined" << std::endl;
+#endif
+        LockType lock(mtx);
+        rotation = options;
+        std::lock_guard<std::mutex> segmentsLock{segmentsMtx};
+        if (!segmentKeeper.joinable()) {
+            stopSegmentKeeper = false;
+            segmentKeeper = std::thread([this]() { keepSegments(); });
+        }
+    }
+
+    /**
+     * @brief Lines thrown away because the async queue was full
+     */
+    uint64_t droppedLines() const
+    {
+        return dropped.load(std::memory_order_relaxed);
+    }
+#endif
+
+private:
+    Logger()
+        : logToFile(false){};
+    Logger(Logger const&){};
+    void operator=(Logger const&){};
+
+#ifdef SIMPLE_LOGGER_ASYNC
+    ~Logger()
+    {
+        stopAsync();
+        stopBuffered();
+        {
+            std::lock_guard<std::mutex> lock{segmentsMtx};
+            stopSegmentKeeper = true;
+        }
+        segmentsCv.notify_one();
+        if (segmentKeeper.joinable())
+            segmentKeeper.join();
+    }
+
+    using AsyncQueue = ConditionBuffer<LogBuffer, 8192, BufferPolicy::Mpmc>;
+
+    // returns false when the line has to be written synchronously
+    bool enqueue(LogBuffer&& logLine)
+    {
+        if (overflow == LogOverflow::Block) {
+            if (!queue->putWait(std::move(logLine)))
+                return false;
+        }
+        else if (!queue->put(std::move(logLine))) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+        return true;
+    }
+
+    void writeQueued()
+    {
+        std::vector<LogBuffer> batch;
+        std::vector<LogSpan> spans;
+        uint64_t unflushed = 0;
+        // queue position up to which the lines were written, the writer is the only consumer
+        uint64_t taken = queue->takeCount();
+        uint64_t reportedDrops = 0;
+        auto lastFlush = std::chrono::steady_clock::now();
+
+        while (true) {
+            batch.clear();
+            lockQueue();
+            if (queue->drain(std::back_inserter(batch)) == 0) {
+                unlockQueue();
+                // idle, nothing may stay behind in the stream buffer
+                if (unflushed > 0)
+                    flushWritten(unflushed, taken);
+                lastFlush = std::chrono::steady_clock::now();
+                if (!queue->waitFor(flushInterval) && stopping)
+                    break;
+                continue;
+            }
+
+            spans.clear();
+            for (auto& line : batch) {
+                line.append('\n');
+                spans.push_back({line.data(), line.size()});
+            }
+            {
+                LockType lock(mtx);
+                auto drops = dropped.load(std::memory_order_relaxed);
+                if (overflow == LogOverflow::DropAndReport && drops != reportedDrops) {
+                    writeLine(NowTime() + " WARNING: Dropped " + std::to_string(drops - reportedDrops) + " log lines");
+                    reportedDrops = drops;
+                }
+                writeSpans(spans.data(), spans.size(), spans.size());
+            }
+            taken = queue->takeCount();
+            unlockQueue();
+            unflushed += batch.size();
+
+            if (std::chrono::steady_clock::now() - lastFlush >= flushInterval) {
+                flushWritten(unflushed, taken);
+                lastFlush = std::chrono::steady_clock::now();
+            }
+        }
+        flushWritten(unflushed, taken);
+    }
+
+    // lines leave the queue and reach the file under it, so flushOnSignal never sees one in between
+    void lockQueue()
+    {
+        while (queueBusy.exchange(true, std::memory_order_acquire)) {
+            std::this_thread::yield();
+        }
+    }
+
+    void unlockQueue()
+    {
+        queueBusy.store(false, std::memory_order_release);
+    }
+
+    void flushWritten(uint64_t& unflushed, uint64_t taken)
+    {
+        {
+            LockType lock(mtx);
+            flushStream();
+        }
+        {
+            std::lock_guard<std::mutex> lock{flushMtx};
+            written = taken;
+        }
+        unflushed = 0;
+        flushedCv.notify_all();
+    }
+
+    // what the signals did before flushOnSignal took them over
+    struct SignalHandling {
+        bool installed[NSIG] = {};
+#ifdef WIN32
+        void (*previous[NSIG])(int) = {};
+#else
+        struct sigaction previous[NSIG] = {};
+#endif
+    };
+
+    static SignalHandling& signalHandling()
+    {
+        static SignalHandling handling;
+        return handling;
+    }
+
+    // called under mtx
+    void installSignalHandlers(bool terminate)
+    {
+        for (int signal : {SIGSEGV, SIGABRT, SIGFPE, SIGILL}) {
+            installSignalHandler(signal);
+        }
+#ifdef SIGBUS
+        installSignalHandler(SIGBUS);
+#endif
+        if (terminate)
+            installSignalHandler(SIGTERM);
+    }
+
+    // an ignored signal stays ignored
+    static void installSignalHandler(int signal)
+    {
+        auto& handling = signalHandling();
+        if (handling.installed[signal])
+            return;
+#ifdef WIN32
+        auto previous = std::signal(signal, &Logger::flushOnSignal);
+        if (previous == SIG_ERR)
+            return;
+        if (previous == SIG_IGN) {
+            std::signal(signal, SIG_IGN);
+            return;
+        }
+        handling.previous[signal] = previous;
+#else
+        auto& previous = handling.previous[signal];
+        if (sigaction(signal, nullptr, &previous) != 0)
+            return;
+        if (!(previous.sa_flags & SA_SIGINFO) && previous.sa_handler == SIG_IGN)
+            return;
+        struct sigaction action = {};
+        action.sa_handler = &Logger::flushOnSignal;
+        sigemptyset(&action.sa_mask);
+        if (sigaction(signal, &action, nullptr) != 0)
+            return;
+#endif
+        handling.installed[signal] = true;
+    }
+
+    /**
+     * Best effort, the dying process may be stopped anywhere. When a thread was
+     * stopped while it had lines out of the queue, nothing is written.
+     * Otherwise the queued lines are read in place and go straight to the
+     * file descriptor: no lock, no allocation, no rotation and no reopened
+     * file. They stay queued, a program which survives the signal may see
+     * them twice. The previous handling of the signal is restored and the
+     * signal raised again, so the program's own handler or the default action
+     * follows.
+     */
+    static void flushOnSignal(int signal)
+    {
+        static std::atomic_flag handled = ATOMIC_FLAG_INIT;
+        if (!handled.test_and_set()) {
+            Logger* logger = getInstance();
+            if (logger->queue && !logger->queueBusy.exchange(true, std::memory_order_acquire)) {
+                logger->queue->peek([logger](const LogBuffer& logLine) {
+                    logger->writeFromSignal(logLine.data(), logLine.size());
+                    logger->writeFromSignal("\n", 1);
+                });
+                logger->unlockQueue();
+            }
+        }
+        auto& handling = signalHandling();
+#ifdef WIN32
+        std::signal(signal, handling.previous[signal] != nullptr ? handling.previous[signal] : SIG_DFL);
+#else
+        sigaction(signal, &handling.previous[signal], nullptr);
+#endif
+        std::raise(signal);
+    }
+
+    // only async-signal-safe calls
+    void writeFromSignal(const char* text, std::size_t size)
+    {
+        if (logToFile) {
+            file.writeFromSignal(text, size);
+            return;
+        }
+        while (size > 0) {
+#ifdef WIN32
+            int written = _write(2, text, static_cast<unsigned>(std::min<std::size_t>(size, INT_MAX)));
+#else
+            auto written = ::write(STDERR_FILENO, text, size);
+            if (written < 0 && errno == EINTR)
+                continue;
+#endif
+            if (written <= 0)
+                return;
+            text += written;
+            size -= static_cast<std::size_t>(written);
+        }
+    }
+
+    void writeLine(const LogBuffer& logLine)
+    {
+        writeLine(logLine.data(), logLine.size());
+    }
+
+    void writeLine(const std::string& logLine)
+    {
+        writeLine(logLine.data(), logLine.size());
+    }
+
+    void writeLine(const char* text, std::size_t size)
+    {
+        LogSpan spans[] = {{text, size}, {"\n", 1}};
+        writeSpans(spans, 2, 1);
+    }
+
+    // lines of the file go out as they are written, only std::cerr may keep some
+    void flushStream()
+    {
+        if (!logToFile)
+            std::cerr.flush();
+    }
+
+    struct BufferedLine {
+        std::uint64_t time;
+        std::size_t offset;
+        std::size_t size;
+    };
+
+    // lines with their newline, one after the other in text
+    struct BufferedLines {
+        std::string text;
+        std::vector<BufferedLine> lines;
+
+        void clear()
+        {
+            text.clear();
+            lines.clear();
+        }
+    };
+
+    struct ThreadBuffer {
+        std::mutex mtx;
+        BufferedLines pending;
+        // what a flush took out of pending, only touched under bufferFlushMtx
+        BufferedLines flushing;
+        std::atomic_bool retired{false};
+    };
+
+    // a thread's buffer outlives the thread until a flush emptied it
+    struct ThreadBufferHandle {
+        std::shared_ptr<ThreadBuffer> buffer;
+
+        ~ThreadBufferHandle()
+        {
+            if (buffer)
+                buffer->retired = true;
+        }
+    };
+
+    ThreadBuffer& threadBuffer()
+    {
+        static thread_local ThreadBufferHandle handle;
+        if (!handle.buffer) {
+            handle.buffer = std::make_shared<ThreadBuffer>();
+            std::lock_guard<std::mutex> lock{threadBuffersMtx};
+            threadBuffers.push_back(handle.buffer);
+        }
+        return *handle.buffer;
+    }
+
+    bool appendBuffered(const LogBuffer& logLine, std::uint64_t time)
+    {
+        if (time == 0) {
+            time = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+                                                  std::chrono::system_clock::now().time_since_epoch())
+                                                  .count());
+        }
+
+        auto& buffer = threadBuffer();
+        std::size_t size;
+        {
+            std::lock_guard<std::mutex> lock{buffer.mtx};
+            auto& pending = buffer.pending;
+            pending.lines.push_back({time, pending.text.size(), logLine.size() + 1});
+            pending.text.append(logLine.data(), logLine.size());
+            pending.text.push_back('\n');
+            size = pending.text.size();
+        }
+        // stopBuffered may have taken the buffers before this line got in
+        if (size >= flushBytes.load(std::memory_order_relaxed) || !buffered.load())
+            flushBuffers();
+        return true;
+    }
+
+    void flushPeriodically()
+    {
+        std::unique_lock<std::mutex> lock{bufferedMtx};
+        while (!stopFlusher) {
+            flusherCv.wait_for(lock, bufferFlushInterval, [this]() { return stopFlusher; });
+            lock.unlock();
+            flushBuffers();
+            lock.lock();
+        }
+    }
+
+    // writes the lines of all threads, merged by time, every thread's own lines stay in order
+    void flushBuffers()
+    {
+        std::lock_guard<std::mutex> flushLock{bufferFlushMtx};
+        {
+            std::lock_guard<std::mutex> lock{threadBuffersMtx};
+            taken.assign(threadBuffers.begin(), threadBuffers.end());
+        }
+        for (auto& buffer : taken) {
+            std::lock_guard<std::mutex> lock{buffer->mtx};
+            std::swap(buffer->pending, buffer->flushing);
+        }
+
+        std::size_t lines = mergeTaken();
+        if (!spans.empty()) {
+            LockType lock(mtx);
+            writeSpans(spans.data(), spans.size(), lines);
+            flushStream();
+        }
+
+        for (auto& buffer : taken) {
+            buffer->flushing.clear();
+        }
+        taken.clear();
+
+        std::lock_guard<std::mutex> lock{threadBuffersMtx};
+        threadBuffers.erase(std::remove_if(threadBuffers.begin(), threadBuffers.end(),
+                                           [](const std::shared_ptr<ThreadBuffer>& buffer) {
+                                               if (!buffer->retired)
+                                                   return false;
+                                               std::lock_guard<std::mutex> bufferLock{buffer->mtx};
+                                               return buffer->pending.lines.empty();
+                                           }),
+                            threadBuffers.end());
+    }
+
+    // k-way merge of the taken buffers into spans, neighbouring lines of one thread share a span,
+    // returns the number of lines
+    std::size_t mergeTaken()
+    {
+        spans.clear();
+        heads.clear();
+        cursors.assign(taken.size(), 0);
+        auto later = [this](std::size_t a, std::size_t b) {
+            return taken[a]->flushing.lines[cursors[a]].time > taken[b]->flushing.lines[cursors[b]].time;
+        };
+        for (std::size_t i = 0; i < taken.size(); ++i) {
+            if (!taken[i]->flushing.lines.empty())
+                heads.push_back(i);
+        }
+        std::make_heap(heads.begin(), heads.end(), later);
+
+        std::size_t lines = 0;
+        std::size_t previous = taken.size();
+        while (!heads.empty()) {
+            ++lines;
+            std::pop_heap(heads.begin(), heads.end(), later);
+            auto i = heads.back();
+            auto& flushing = taken[i]->flushing;
+            const auto& line = flushing.lines[cursors[i]];
+            if (previous == i)
+                spans.back().size += line.size;
+            else
+                spans.push_back({flushing.text.data() + line.offset, line.size});
+            previous = i;
+
+            if (++cursors[i] < flushing.lines.size())
+                std::push_heap(heads.begin(), heads.end(), later);
+            else
+                heads.pop_back();
+        }
+        return lines;
+    }
+
+    // a segment the logging threads are done with
+    struct ClosedSegment {
+        LogFile file;
+        std::string path;
+        std::string dir;
+        std::string name;
+        LogRotation rotation;
+    };
+
+    // the caller holds mtx
+    void rotateIfFull()
+    {
+        if ((rotation.maxBytes > 0 && segmentBytes >= rotation.maxBytes)
+            || (rotation.maxLines > 0 && segmentLines >= rotation.maxLines))
+            openFile(true);
+    }
+
+    void keepSegments()
+    {
+        std::unique_lock<std::mutex> lock{segmentsMtx};
+        while (true) {
+            segmentsCv.wait(lock, [this]() { return stopSegmentKeeper || !closedSegments.empty(); });
+            if (closedSegments.empty())
+                break;
+            auto segment = std::move(closedSegments.front());
+            closedSegments.pop_front();
+            lock.unlock();
+
+            segment.file.close();
+            if (segment.rotation.compress)
+                compressSegment(segment.path);
+            if (segment.rotation.maxFiles > 0)
+                removeOldSegments(segment.dir, segment.name, segment.rotation.maxFiles);
+            lock.lock();
+        }
+    }
+
+    static void compressSegment(const std::string& path)
+    {
+#ifdef SIMPLE_LOGGER_ZLIB
+        std::ifstream in{path, std::ios::binary};
+        gzFile out = gzopen((path + ".gz").c_str(), "wb");
+        if (!in || out == nullptr) {
+            if (out != nullptr)
+                gzclose(out);
+            return;
+        }
+        std::vector<char> chunk(64 * 1024);
+        bool complete = true;
+        while (in.read(chunk.data(), static_cast<std::streamsize>(chunk.size())) || in.gcount() > 0) {
+            if (gzwrite(out, chunk.data(), static_cast<unsigned>(in.gcount())) <= 0) {
+                complete = false;
+                break;
+            }
+        }
+        if (gzclose(out) == Z_OK && complete) {
+            std::error_code ec;
+            fs::remove(path, ec);
+        }
+#else
+        (void)path;
+#endif
+    }
+
+    // keeps the newest maxFiles closed segments and the current one
+    static void removeOldSegments(const std::string& dir, const std::string& name, std::size_t maxFiles)
+    {
+        struct Segment {
+            std::string date;
+            std::size_t index;
+            fs::path path;
+        };
+        std::vector<Segment> segments;
+        std::error_code ec;
+        for (fs::directory_iterator it(dir.empty() ? fs::path(".") : fs::path(dir), ec), end; !ec && it != end;
+             it.increment(ec)) {
+            Segment segment;
+            if (parseSegment(it->path().filename().string(), name, segment.date, segment.index)) {
+                segment.path = it->path();
+                segments.push_back(std::move(segment));
+            }
+        }
+        std::sort(segments.begin(), segments.end(), [](const Segment& a, const Segment& b) {
+            return a.date != b.date ? a.date > b.date : a.index > b.index;
+        });
+
+        // a segment being compressed shows up twice
+        std::size_t kept = 0;
+        for (std::size_t i = 0; i < segments.size(); ++i) {
+            bool sameAsPrevious = i > 0 && segments[i].date == segments[i - 1].date
+                                  && segments[i].index == segments[i - 1].index;
+            if (!sameAsPrevious)
+                ++kept;
+            if (kept > maxFiles + 1)
+                fs::remove(segments[i].path, ec);
+        }
+    }
+#endif
+
+    // the caller holds mtx
+    void writeSpans(const LogSpan* spans, std::size_t count, std::size_t lines)
+    {
+        if (logToFile) {
+            if (openTimeIsDifferent())
+                openFile();
+            file.write(spans, count);
+#ifdef SIMPLE_LOGGER_ASYNC
+            for (std::size_t i = 0; i < count; ++i) {
+                segmentBytes += spans[i].size;
+            }
+            segmentLines += lines;
+            rotateIfFull();
+#else
+            (void)lines;
+#endif
+        }
+        else {
+            for (std::size_t i = 0; i < count; ++i) {
+                std::cerr.write(spans[i].data, static_cast<std::streamsize>(spans[i].size));
+            }
+            std::cerr.flush();
+        }
+    }
+
+    // the current file belongs to one local day, [dayBegin, dayEnd)
+    bool openTimeIsDifferent()
+    {
+        const auto t = std::time(nullptr);
+        return t >= dayEnd || t < dayBegin;
+    }
+
+    static tm localTime(time_t t)
+    {
+        tm result;
+#ifdef WIN32
+        localtime_s(&result, &t);
+#else
+        localtime_r(&t, &result);
+#endif
+        return result;
+    }
+
+    // mktime normalizes a day past the end of the month and finds the offset across DST changes
+    static time_t localMidnight(tm day, int daysAfter)
+    {
+        day.tm_mday += daysAfter;
+        day.tm_hour = 0;
+        day.tm_min = 0;
+        day.tm_sec = 0;
+        day.tm_isdst = -1;
+        return std::mktime(&day);
+    }
+
+    // nextSegment continues the day in a new segment, otherwise the last segment of the day is reopened
+    void openFile(bool nextSegment = false)
+    {
+        tm td = localTime(std::time(nullptr));
+        dayBegin = localMidnight(td, 0);
+        dayEnd = localMidnight(td, 1);
+
+        std::stringstream date;
+        date << (td.tm_year + 1900) << "-" << std::setw(2) << std::setfill('0') << td.tm_mon + 1 << "-" << std::setw(2)
+             << std::setfill('0') << td.tm_mday;
+        if (date.str() != segmentDate) {
+            segmentDate = date.str();
+            segmentIndex = lastSegment();
+        }
+        else if (nextSegment) {
+            ++segmentIndex;
+        }
+
+        std::stringstream ss;
+        if (!logsDir.empty()) {
+            try {
+                if (!fs::exists(logsDir))
+                    fs::create_directories(logsDir);
+            }
+            catch (...) {
+                std::cerr << "Cannot create directory: " << logsDir << std::endl;
+            }
+            ss << logsDir << "/";
+        }
+        ss << logsName << "_" << segmentDate;
+        if (segmentIndex > 0)
+            ss << "." << segmentIndex;
+        ss << ".log";
+        std::cerr << "Opening log file: " << ss.str() << std::endl;
+
+        LogFile next;
+        if (!next.open(ss.str(), mapChunk))
+            std::cerr << "Cannot open log file: " << ss.str() << std::endl;
+        std::swap(file, next);
+#ifdef SIMPLE_LOGGER_ASYNC
+        segmentBytes = file.size();
+        segmentLines = 0;
+        std::unique_lock<std::mutex> segmentsLock{segmentsMtx};
+        if (segmentKeeper.joinable() && next.isOpen() && !filePath.empty()) {
+            closedSegments.push_back({std::move(next), filePath, logsDir, logsName, rotation});
+            segmentsLock.unlock();
+            segmentsCv.notify_one();
+        }
+#endif
+        filePath = ss.str();
+    }
+
+    // date and index of name_YYYY-MM-DD[.N].log[.gz], false for other files
+    static bool parseSegment(const std::string& file, const std::string& name, std::string& date, std::size_t& index)
+    {
+        const std::size_t dateSize = 10;
+        if (file.compare(0, name.size() + 1, name + "_") != 0 || file.size() < name.size() + 1 + dateSize)
+            return false;
+        date = file.substr(name.size() + 1, dateSize);
+        auto rest = file.substr(name.size() + 1 + dateSize);
+        if (rest.size() >= 3 && rest.compare(rest.size() - 3, 3, ".gz") == 0)
+            rest.resize(rest.size() - 3);
+        if (rest.size() < 4 || rest.compare(rest.size() - 4, 4, ".log") != 0)
+            return false;
+        rest.resize(rest.size() - 4);
+        index = 0;
+        if (rest.empty())
+            return true;
+        if (rest[0] != '.' || rest.size() == 1)
+            return false;
+        for (std::size_t i = 1; i < rest.size(); ++i) {
+            if (rest[i] < '0' || rest[i] > '9')
+                return false;
+            index = index * 10 + static_cast<std::size_t>(rest[i] - '0');
+        }
+        return true;
+    }
+
+    // index of the segment of segmentDate to append to: the last one, or the one after when it is compressed
+    std::size_t lastSegment() const
+    {
+        std::size_t last = 0;
+        bool found = false;
+        bool compressed = false;
+        try {
+            auto dir = logsDir.empty() ? fs::path(".") : fs::path(logsDir);
+            if (!fs::exists(dir))
+                return 0;
+            for (fs::directory_iterator it(dir), end; it != end; ++it) {
+                auto file = it->path().filename().string();
+                std::string date;
+                std::size_t index;
+                if (!parseSegment(file, logsName, date, index) || date != segmentDate || (found && index < last))
+                    continue;
+                bool isCompressed = file.size() > 3 && file.compare(file.size() - 3, 3, ".gz") == 0;
+                // the plain file wins while its compressed copy is being written
+                compressed = !found || index > last ? isCompressed : compressed && isCompressed;
+                last = index;
+                found = true;
+            }
+        }
+        catch (...) {
+        }
+        return compressed ? last + 1 : last;
+    }
+
+    friend class LogModuleSite;
+
+    // the caller holds levelsMtx
+    int moduleLevel(const std::string& module) const
+    {
+        auto it = moduleLevels.find(module);
+        return it != moduleLevels.end() ? it->second : currentLevel();
+    }
+
+    // the caller holds levelsMtx
+    void updateModuleSites(const std::string& module)
+    {
+        int level = moduleLevel(module);
+        for (auto* site : moduleSites) {
+            if (module == site->module())
+                site->level_.store(level, std::memory_order_relaxed);
+        }
+    }
+
+    // sites are function local statics, they stay in place until the program ends
+    void registerSite(LogModuleSite* site)
+    {
+        LockType lock(levelsMtx);
+        site->level_.store(moduleLevel(site->module()), std::memory_order_relaxed);
+        moduleSites.push_back(site);
+    }
+
+    friend class LogRateSite;
+
+    void registerSite(LogRateSite* site)
+    {
+        LockType lock(rateSitesMtx);
+        rateSites.push_back(site);
+    }
+
+    MutexType levelsMtx;
+    std::map<std::string, int> moduleLevels;
+    std::vector<LogModuleSite*> moduleSites;
+    MutexType rateSitesMtx;
+    std::vector<LogRateSite*> rateSites;
+    bool logToFile;
+    time_t dayBegin = 0;
+    time_t dayEnd = 0;
+    MutexType mtx;
+    std::string logsName;
+    std::string logsDir;
+    LogFile file;
+    std::size_t mapChunk = 0;
+    std::string filePath;
+    std::string segmentDate;
+    std::size_t segmentIndex = 0;
+
+#ifdef SIMPLE_LOGGER_ASYNC
+    std::atomic_bool async{false};
+    std::atomic_bool stopping{false};
+    LogOverflow overflow = LogOverflow::Block;
+    std::chrono::milliseconds flushInterval{200};
+    std::unique_ptr<AsyncQueue> queue;
+    std::thread writer;
+    std::atomic<uint64_t> dropped{0};
+    // a thread has lines out of the queue which are not written yet
+    std::atomic_bool queueBusy{false};
+    std::mutex flushMtx;
+    std::condition_variable flushedCv;
+    // queue position up to which lines are written and flushed
+    uint64_t written = 0;
+
+    std::atomic_bool buffered{false};
+    std::mutex bufferedMtx;
+    std::condition_variable flusherCv;
+    bool stopFlusher = false;
+    std::chrono::milliseconds bufferFlushInterval{200};
+    std::atomic<std::size_t> flushBytes{64 * 1024};
+    std::thread flusher;
+    std::mutex threadBuffersMtx;
+    std::vector<std::shared_ptr<ThreadBuffer>> threadBuffers;
+    // state of a flush, kept to reuse the memory
+    std::mutex bufferFlushMtx;
+    std::vector<std::shared_ptr<ThreadBuffer>> taken;
+    std::vector<std::size_t> cursors;
+    std::vector<std::size_t> heads;
+    std::vector<LogSpan> spans;
+
+    LogRotation rotation;
+    std::uint64_t segmentBytes = 0;
+    std::uint64_t segmentLines = 0;
+    std::mutex segmentsMtx;
+    std::condition_variable segmentsCv;
+    std::deque<ClosedSegment> closedSegments;
+    bool stopSegmentKeeper = false;
+    std::thread segmentKeeper;
+#endif
+};
+
+/**
+ * @brief One log line, formatted into an inline buffer without touching the heap
+ *
+ * Strings, characters, integers and floating point numbers have a fast path.
+ * Anything else goes through its operator<< on a thread local stream writing
+ * into the same buffer; from then on the rest of the line takes that way too,
+ * so manipulators apply the way they would on an ostream.
+ */
+class LogLine {
+public:
+    explicit LogLine(int level)
+    {
+        char prefix[32];
+        buffer.append(prefix, formatNowTime(prefix, time));
+        appendLevel(level);
+    }
+
+    LogLine(const LogLine&) = delete;
+    LogLine& operator=(const LogLine&) = delete;
+
+    LogLine& operator<<(const char* text)
+    {
+        if (os || text == nullptr)
+            return stream(text);
+        buffer.append(text, std::strlen(text));
+        return *this;
+    }
+
+    LogLine& operator<<(const std::string& text)
+    {
+        if (os)
+            return stream(text);
+        buffer.append(text.data(), text.size());
+        return *this;
+    }
+
+#if (__cplusplus >= 201703L) || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L)
+    LogLine& operator<<(std::string_view text)
+    {
+        if (os)
+            return stream(text);
+        buffer.append(text.data(), text.size());
+        return *this;
+    }
+#endif
+
+    LogLine& operator<<(char c)
+    {
+        if (os)
+            return stream(c);
+        buffer.append(c);
+        return *this;
+    }
+
+    LogLine& operator<<(signed char c)
+    {
+        return *this << static_cast<char>(c);
+    }
+
+    LogLine& operator<<(unsigned char c)
+    {
+        return *this << static_cast<char>(c);
+    }
+
+    LogLine& operator<<(bool value)
+    {
+        if (os)
+            return stream(value);
+        buffer.append(value ? '1' : '0');
+        return *this;
+    }
+
+    template <class T>
+    typename std::enable_if<std::is_integral<T>::value, LogLine&>::type operator<<(T value)
+    {
+        if (os)
+            return stream(value);
+        char digits[detail::IntegerDigits];
+        char* end = digits + sizeof(digits);
+        char* begin = detail::formatInteger(end, value, std::is_signed<T>());
+        buffer.append(begin, static_cast<std::size_t>(end - begin));
+        return *this;
+    }
+
+    template <class T>
+    typename std::enable_if<std::is_floating_point<T>::value, LogLine&>::type operator<<(T value)
+    {
+        if (os)
+            return stream(value);
+        char digits[64];
+        buffer.append(digits, detail::formatFloating(digits, sizeof(digits), value));
+        return *this;
+    }
+
+    template <class T>
+    typename std::enable_if<!std::is_arithmetic<T>::value, LogLine&>::type operator<<(const T& value)
+    {
+        return stream(value);
+    }
+
+    LogLine& operator<<(std::ostream& (*manipulator)(std::ostream&))
+    {
+        return stream(manipulator);
+    }
+
+    LogLine& operator<<(std::ios_base& (*manipulator)(std::ios_base&))
+    {
+        return stream(manipulator);
+    }
+
+    ~LogLine()
+    {
+        if (os)
+            os->detach();
+        Simple::Logger::getInstance()->writeStream(std::move(buffer), time);
+    }
+
+private:
+    void appendLevel(int level)
+    {
+        const char* prefix = detail::levelPrefix(level);
+        buffer.append(prefix, std::strlen(prefix));
+    }
+
+    template <class T>
+    LogLine& stream(const T& value)
+    {
+        if (!os)
+            os = acquireStream();
+        *os << value;
+        return *this;
+    }
+
+    detail::LogStream* acquireStream()
+    {
+        static thread_local detail::LogStream shared;
+        if (!shared.attached()) {
+            shared.attach(buffer);
+            return &shared;
+        }
+        // the operator<< of a value being logged logs a line of its own
+        own.reset(new detail::LogStream);
+        own->attach(buffer);
+        return own.get();
+    }
+
+    LogBuffer buffer;
+    std::uint64_t time = 0;
+    detail::LogStream* os = nullptr;
+    std::unique_ptr<detail::LogStream> own;
+};
+
+// the date and time up to the second is formatted once per second and thread,
+// every line copies it and writes its milliseconds behind
+namespace detail {
+struct TimestampCache {
+    static constexpr std::size_t Size = 32;
+    char prefix[Size];
+    std::size_t length = 0;
+};
+
+inline void appendMilliseconds(char* buffer, std::size_t& length, long milliseconds)
+{
+    buffer[length++] = '.';
+    buffer[length++] = static_cast<char>('0' + milliseconds / 100);
+    buffer[length++] = static_cast<char>('0' + milliseconds / 10 % 10);
+    buffer[length++] = static_cast<char>('0' + milliseconds % 10);
+}
+} // namespace detail
+
+#if defined(WIN32) || defined(_WIN32) || defined(__WIN32__)
+inline std::size_t formatNowTime(char* buffer, std::uint64_t& microseconds)
+{
+    static thread_local detail::TimestampCache cache;
+    static thread_local SYSTEMTIME cachedSecond = {};
+
+    // FILETIME counts 100 ns since 1601
+    FILETIME fileTime;
+    GetSystemTimeAsFileTime(&fileTime);
+    microseconds = ((static_cast<std::uint64_t>(fileTime.dwHighDateTime) << 32 | fileTime.dwLowDateTime)
+                    - 116444736000000000ULL)
+                   / 10;
+    SYSTEMTIME now;
+    GetLocalTime(&now);
+    long milliseconds = now.wMilliseconds;
+    now.wMilliseconds = 0;
+    if (cache.length == 0 || std::memcmp(&now, &cachedSecond, sizeof(now)) != 0) {
+        const int MAX_LEN = 200;
+        char timeBuffer[MAX_LEN];
+        char dateBuffer[MAX_LEN];
+        if (GetTimeFormatA(LOCALE_USER_DEFAULT, 0, &now, "HH':'mm':'ss", timeBuffer, MAX_LEN) == 0
+            || GetDateFormatA(LOCALE_USER_DEFAULT, 0, &now, "dd'.'MM'.'yyyy", dateBuffer, MAX_LEN) == 0) {
+            static const char error[] = "Error in NowTime()";
+            std::memcpy(buffer, error, sizeof(error) - 1);
+            return sizeof(error) - 1;
+        }
+        int written = sprintf_s(cache.prefix, "%s %s", dateBuffer, timeBuffer);
+        cache.length = written < 0 ? 0 : static_cast<std::size_t>(written);
+        cachedSecond = now;
+    }
+
+    std::size_t length = cache.length;
+    std::memcpy(buffer, cache.prefix, length);
+    detail::appendMilliseconds(buffer, length, milliseconds);
+    return length;
+}
+#else
+inline std::size_t formatNowTime(char* buffer, std::uint64_t& microseconds)
+{
+    static thread_local detail::TimestampCache cache;
+    static thread_local time_t cachedSecond = -1;
+
+    struct timeval tv;
+    gettimeofday(&tv, 0);
+    microseconds = static_cast<std::uint64_t>(tv.tv_sec) * 1000000 + static_cast<std::uint64_t>(tv.tv_usec);
+    if (tv.tv_sec != cachedSecond) {
+        time_t t = tv.tv_sec;
+        tm r;
+        localtime_r(&t, &r);
+        cache.length = strftime(cache.prefix, sizeof(cache.prefix), "%F %H:%M:%S", &r);
+        cachedSecond = tv.tv_sec;
+    }
+
+    std::size_t length = cache.length;
+    std::memcpy(buffer, cache.prefix, length);
+    detail::appendMilliseconds(buffer, length, (long)tv.tv_usec / 1000);
+    return length;
+}
+#endif // WIN32
+
+inline std::size_t formatNowTime(char* buffer)
+{
+    std::uint64_t microseconds;
+    return formatNowTime(buffer, microseconds);
+}
+
+inline std::string NowTime()
+{
+    char buffer[32];
+    return std::string(buffer, formatNowTime(buffer));
+}
+
+inline LogModuleSite::LogModuleSite(const char* module)
+    : module_(module)
+{
+    Logger::getInstance()->registerSite(this);
+}
+
+/**
+ * @brief State of one LOG_EVERY_N, LOG_FIRST_N or LOG_EVERY_MS call site
+ *
+ * Deciding whether a line goes out only touches the atomics of the site, so
+ * a statement hit from many threads at once costs little more than the
+ * lines it lets through. The first line after suppressed ones is preceded
+ * by a summary, Logger::reportSuppressed writes the rest.
+ */
+class LogRateSite {
+public:
+    // true when the line is suppressed
+    struct Decision {
+        const LogRateSite* site;
+        bool suppress;
+        std::uint64_t suppressedBefore;
+
+        explicit operator bool() const
+        {
+            return suppress;
+        }
+
+        void summarize() const
+        {
+            if (suppressedBefore > 0)
+                site->summarize(suppressedBefore);
+        }
+    };
+
+    LogRateSite(int level, const char* file, int line)
+        : level(level)
+        , file(file)
+        , line(line)
+    {
+        Logger::getInstance()->registerSite(this);
+    }
+
+    // lets the first of every n calls through
+    Decision everyN(std::uint64_t n)
+    {
+        auto calls = count.fetch_add(1, std::memory_order_relaxed);
+        if (n > 1 && calls % n != 0)
+            return suppressed();
+        return passed();
+    }
+
+    // lets the first n calls through, then only counts
+    Decision firstN(std::uint64_t n)
+    {
+        if (count.load(std::memory_order_relaxed) >= n || count.fetch_add(1, std::memory_order_relaxed) >= n)
+            return suppressed();
+        return passed();
+    }
+
+    // lets one call through per interval, the thread which moves the next time on wins
+    Decision everyMs(std::int64_t milliseconds)
+    {
+        std::int64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(
+                               std::chrono::steady_clock::now().time_since_epoch())
+                               .count();
+        auto next = nextTime.load(std::memory_order_relaxed);
+        if (now < next || !nextTime.compare_exchange_strong(next, now + milliseconds, std::memory_order_relaxed))
+            return suppressed();
+        return passed();
+    }
+
+    std::uint64_t takeSuppressed()
+    {
+        return suppressedCount.load(std::memory_order_relaxed) > 0
+                   ? suppressedCount.exchange(0, std::memory_order_relaxed)
+                   : 0;
+    }
+
+    void summarize(std::uint64_t lines) const;
+
+private:
+    Decision suppressed()
+    {
+        suppressedCount.fetch_add(1, std::memory_order_relaxed);
+        return {this, true, 0};
+    }
+
+    Decision passed()
+    {
+        return {this, false, takeSuppressed()};
+    }
+
+    const int level;
+    const char* const file;
+    const int line;
+    std::atomic<std::uint64_t> count{0};
+    std::atomic<std::int64_t> nextTime{std::numeric_limits<std::int64_t>::min()};
+    std::atomic<std::uint64_t> suppressedCount{0};
+};
+
+inline void LogRateSite::summarize(std::uint64_t lines) const
+{
+    if (level <= Logger::currentLevel())
+        LogLine(level) << "Suppressed " << lines << " lines of " << file << ":" << line;
+}
+
+inline void Logger::reportSuppressed()
+{
+    LockType lock(rateSitesMtx);
+    for (auto* site : rateSites) {
+        if (auto lines = site->takeSuppressed())
+            site->summarize(lines);
+    }
+}
+
+} // namespace Simple
+
+/**
+ * Statements above this level are compiled out, arguments included. Release
+ * builds keep Info and more severe, define it to Simple::LogLevel::Trace to
+ * keep everything.
+ */
+#ifndef SIMPLE_LOGGER_MAX_LEVEL
+#ifdef NDEBUG
+#define SIMPLE_LOGGER_MAX_LEVEL Simple::LogLevel::Info
+#else
+#define SIMPLE_LOGGER_MAX_LEVEL Simple::LogLevel::Trace
+#endif
+#endif
+
+#define LOG(level)                                                                                                     \
+    if (level > SIMPLE_LOGGER_MAX_LEVEL || level > Simple::Logger::currentLevel())                                     \
+        ;                                                                                                              \
+    else                                                                                                               \
+        Simple::LogLine(level)
+
+/**
+ * LOG_MODULE("module", level) follows the level of the module when one is set
+ * with Logger::setModuleLevel, the reporting level otherwise. The call site
+ * looks the module up once and then reads its cached level.
+ */
+#define LOG_MODULE(module, statementLevel)                                                                             \
+    if (statementLevel > SIMPLE_LOGGER_MAX_LEVEL || statementLevel > []() {                                            \
+            static Simple::LogModuleSite simpleLogSite{module};                                                        \
+            return simpleLogSite.level();                                                                              \
+        }())                                                                                                           \
+        ;                                                                                                              \
+    else                                                                                                               \
+        Simple::LogLine(statementLevel)
+
+#define LOG_INFO LOG(Simple::LogLevel::Info)
+
+#define LOG_WARNING LOG(Simple::LogLevel::Warning)
+
+#define LOG_DEBUG LOG(Simple::LogLevel::Debug)
+
+#define LOG_TRACE LOG(Simple::LogLevel::Trace)
+
+#define LOG_ERROR LOG(Simple::LogLevel::Error)
+
+#define SIMPLE_LOG_RATE(statementLevel, decide)                                                                        \
+    if (statementLevel > SIMPLE_LOGGER_MAX_LEVEL || statementLevel > Simple::Logger::currentLevel())                   \
+        ;                                                                                                              \
+    else if (Simple::LogRateSite::Decision simpleRateDecision = []() -> Simple::LogRateSite& {                         \
+                 static Simple::LogRateSite simpleRateSite{statementLevel, __FILE__, __LINE__};                        \
+                 return simpleRateSite;                                                                                \
+             }().decide)                                                                                               \
+        ;                                                                                                              \
+    else                                                                                                               \
+        simpleRateDecision.summarize(), Simple::LogLine(statementLevel)
+
+/**
+ * LOG_EVERY_N(level, n) writes the first of every n lines of the statement,
+ * LOG_FIRST_N(level, n) the first n and LOG_EVERY_MS(level, ms) at most one
+ * line per interval. A line after suppressed ones is preceded by a summary
+ * with their number.
+ */
+#define LOG_EVERY_N(level, n) SIMPLE_LOG_RATE(level, everyN(n))
+
+#define LOG_FIRST_N(level, n) SIMPLE_LOG_RATE(level, firstN(n))
+
+#define LOG_EVERY_MS(level, milliseconds) SIMPLE_LOG_RATE(level, everyMs(milliseconds))
+
+#define LOG_REPORTING_LEVEL(level)                                                                                     \
+    Simple::Logger::getInstance()->setReportingLevel(Simple::Logger::levelFromString(level))
+
+#define LOG_MODULE_LEVEL(module, level)                                                                                \
+    Simple::Logger::getInstance()->setModuleLevel(module, Simple::Logger::levelFromString(level))
 
 #define LOG_TO_FILE(dir, file) Simple::Logger::getInstance()->setFileName(dir, file)
 
@@ -0,0 +1,254 @@
+#ifndef SIMPLE_PARALLEL_ALGORITHMS_HPP
+#define SIMPLE_PARALLEL_ALGORITHMS_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+
+#include "ThreadPool.hpp"
+
+namespace Simple {
+namespace detail {
+
+/**
+ * @brief Index range shared by all participants of one parallel algorithm
+ *
+ * Participants claim chunks with guided self-scheduling: a chunk is a
+ * share of the remaining work, so chunks shrink towards the end of the
+ * range but never below the grain. Slow workers therefore take fewer
+ * chunks instead of holding up the whole call.
+ */
+class ParallelRange {
+public:
+    ParallelRange(size_t size, size_t grain, size_t participants)
+        : size{size}
+        , grain{grain}
+        , participants{participants}
+    {
+    }
+
+    template <typename Participant>
+    void participate(Participant& participant)
+    {
+        ++active;
+        participant(*this);
+        if (--active == 0) {
+            std::lock_guard<std::mutex> lock{mtx};
+            cv.notify_all();
+        }
+    }
+
+    // calls body(begin, end) for every claimed chunk, skips the rest after failure
+    template <typename Body>
+    void process(Body& body)
+    {
+        size_t begin;
+        size_t end;
+        while (claim(begin, end)) {
+            if (failed)
+                continue;
+            try {
+                body(begin, end);
+            }
+            catch (...) {
+                std::lock_guard<std::mutex> lock{mtx};
+                if (!error)
+                    error = std::current_exception();
+                failed = true;
+            }
+        }
+    }
+
+    // caller already went through the whole range, wait for chunks still running elsewhere
+    void wait()
+    {
+        std::unique_lock<std::mutex> lock{mtx};
+        cv.wait(lock, [&]() { return active == 0; });
+        if (error)
+            std::rethrow_exception(error);
+    }
+
+private:
+    bool claim(size_t& begin, size_t& end)
+    {
+        size_t current = next.load();
+        while (current < size) {
+            size_t chunk = std::max(grain, (size - current) / (2 * participants));
+            size_t last = std::min(size, current + chunk);
+            if (next.compare_exchange_weak(current, last)) {
+                begin = current;
+                end = last;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    const size_t size;
+    const size_t grain;
+    const size_t participants;
+    std::atomic_size_t next{0};
+    std::atomic_size_t active{0};
+    std::atomic_bool failed{false};
+    std::exception_ptr error;
+    std::mutex mtx;
+    std::condition_variable cv;
+};
+
+/**
+ * @brief Run participant on the calling thread and on helper tasks
+ *
+ * The calling thread works on the range as well, so calling a parallel
+ * algorithm from inside a worker of the same pool does not deadlock even
+ * if no other worker is free. Helpers which start after everything is
+ * done find no chunk and return immediately.
+ */
+template <typename Participant>
+void runParallel(ThreadPool& pool, size_t size, size_t grain, Participant participant)
+{
+    if (size == 0)
+        return;
+
+    size_t workers = std::max<size_t>(pool.capacity(), 1);
+    if (grain == 0)
+        grain = std::max<size_t>(size / (workers * 64), 1);
+    size_t participants = std::min(workers, (size + grain - 1) / grain);
+
+    struct State {
+        State(size_t size, size_t grain, size_t participants, Participant&& participant)
+            : range{size, grain, participants}
+            , participant{std::move(participant)}
+        {
+        }
+
+        ParallelRange range;
+        Participant participant;
+    };
+    auto state = std::make_shared<State>(size, grain, participants, std::move(participant));
+
+    for (size_t i = 1; i < participants; ++i) {
+        pool.post([state]() { state->range.participate(state->participant); });
+    }
+    state->range.participate(state->participant);
+    state->range.wait();
+}
+} // namespace detail
+
+/**
+ * @brief Call fun(i) for every index in [first, last)
+ *
+ * @param pool
+ * @param first
+ * @param last
+ * @param fun
+ * @param grain smallest number of indices processed at once, 0 picks it from range and pool size
+ */
+template <typename Index, typename F>
+std::enable_if_t<std::is_integral<Index>::value> parallelFor(ThreadPool& pool, Index first, Index last, F fun,
+                                                              size_t grain = 0)
+{
+    if (last <= first)
+        return;
+    detail::runParallel(pool, static_cast<size_t>(last - first), grain, [first, fun](detail::ParallelRange& range) {
+        auto body = [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                fun(static_cast<Index>(first + i));
+            }
+        };
+        range.process(body);
+    });
+}
+
+/**
+ * @brief Call fun(element) for every element in [first, last)
+ *
+ * Iterators have to be random access.
+ */
+template <typename Iterator, typename F>
+std::enable_if_t<!std::is_integral<Iterator>::value> parallelFor(ThreadPool& pool, Iterator first, Iterator last,
+                                                                  F fun, size_t grain = 0)
+{
+    detail::runParallel(pool, static_cast<size_t>(std::distance(first, last)), grain,
+                        [first, fun](detail::ParallelRange& range) {
+                            auto body = [&](size_t begin, size_t end) {
+                                for (auto it = first + begin; it != first + end; ++it) {
+                                    fun(*it);
+                                }
+                            };
+                            range.process(body);
+                        });
+}
+
+/**
+ * @brief Store op(element) for every element in [first, last) to range starting at dest
+ *
+ * Both iterators have to be random access.
+ *
+ * @return iterator past the last written element
+ */
+template <typename InputIterator, typename OutputIterator, typename UnaryOperation>
+OutputIterator parallelTransform(ThreadPool& pool, InputIterator first, InputIterator last, OutputIterator dest,
+                                 UnaryOperation op, size_t grain = 0)
+{
+    auto size = std::distance(first, last);
+    detail::runParallel(pool, static_cast<size_t>(size), grain, [first, dest, op](detail::ParallelRange& range) {
+        auto body = [&](size_t begin, size_t end) {
+            auto out = dest + begin;
+            for (auto it = first + begin; it != first + end; ++it, ++out) {
+                *out = op(*it);
+            }
+        };
+        range.process(body);
+    });
+    return dest + size;
+}
+
+/**
+ * @brief Combine init and all elements in [first, last) with op
+ *
+ * Every participant folds its chunks locally and results are merged
+ * once per participant, not once per element. As with std::reduce the
+ * operation has to be associative and commutative.
+ */
+template <typename Iterator, typename T, typename BinaryOperation>
+T parallelReduce(ThreadPool& pool, Iterator first, Iterator last, T init, BinaryOperation op, size_t grain = 0)
+{
+    struct Result {
+        std::mutex mtx;
+        std::optional<T> value;
+    };
+    auto result = std::make_shared<Result>();
+
+    detail::runParallel(
+        pool, static_cast<size_t>(std::distance(first, last)), grain,
+        [first, op, result](detail::ParallelRange& range) {
+            std::optional<T> local;
+            auto body = [&](size_t begin, size_t end) {
+                for (auto it = first + begin; it != first + end; ++it) {
+                    if (local)
+                        local = op(std::move(*local), *it);
+                    else
+                        local = *it;
+                }
+            };
+            range.process(body);
+
+            if (local) {
+                std::lock_guard<std::mutex> lock{result->mtx};
+                result->value = result->value ? op(std::move(*result->value), std::move(*local)) : std::move(*local);
+            }
+        });
+
+    if (result->value)
+        return op(std::move(init), std::move(*result->value));
+    return init;
+}
+} // namespace Simple
+
+#endif /* ifndef SIMPLE_PARALLEL_ALGORITHMS_HPP */
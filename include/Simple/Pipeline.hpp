@@ -0,0 +1,605 @@
+#ifndef SIMPLE_PIPELINE_HPP
+#define SIMPLE_PIPELINE_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "ConditionBuffer.hpp"
+#include "ThreadPool.hpp"
+
+namespace Simple {
+
+/**
+ * @brief Whether a stage hands its results on in input order
+ */
+enum class StageOrder {
+    // results leave as soon as they are ready
+    Unordered,
+    // results leave in the order elements entered the pipeline
+    Ordered
+};
+
+/**
+ * @brief Snapshot of counters of one pipeline stage
+ */
+struct PipelineStageStats {
+    std::string name;
+    size_t workers = 0;
+    // elements taken from the input buffer, including failed ones
+    uint64_t processed = 0;
+    // elements on which the stage function threw
+    uint64_t failed = 0;
+    // time spent in the stage function summed over workers
+    std::chrono::nanoseconds busy{0};
+    // since start, until the last worker finished
+    std::chrono::nanoseconds elapsed{0};
+    size_t capacity = 0;
+    // elements in the input buffer now, plus those whose producers wait for room
+    int64_t queued = 0;
+    // mean of queued seen by workers taking an element, above capacity means blocked producers
+    double averageQueued = 0;
+    // most results an ordered stage held back at once waiting for earlier ones
+    size_t reorderPeak = 0;
+
+    double throughput() const
+    {
+        return elapsed.count() == 0 ? 0.0 : static_cast<double>(processed) * 1e9 / static_cast<double>(elapsed.count());
+    }
+
+    /**
+     * @brief Share of worker time spent in the stage function
+     *
+     * The stage closest to 1, usually sitting behind a full buffer, is the
+     * bottleneck.
+     */
+    double utilization() const
+    {
+        auto total = static_cast<double>(elapsed.count()) * static_cast<double>(workers);
+        return total == 0 ? 0.0 : static_cast<double>(busy.count()) / total;
+    }
+};
+
+namespace detail {
+
+template <typename T>
+struct PipelineItem {
+    uint64_t sequence = 0;
+    // empty when an earlier stage failed on the element, keeps sequence numbers dense
+    std::optional<T> value;
+};
+
+template <typename T>
+class PipelineInput {
+public:
+    virtual ~PipelineInput() = default;
+
+    // waits for room, false once the input is disabled
+    virtual bool push(PipelineItem<T>&& item) = 0;
+
+    // no more elements will be pushed
+    virtual void finish() = 0;
+};
+
+template <typename T>
+class PipelineOutput {
+public:
+    virtual ~PipelineOutput() = default;
+
+    virtual void connect(PipelineInput<T>* next) = 0;
+};
+
+// parts of the pipeline the shared state shuts down
+class PipelineEnd {
+public:
+    virtual ~PipelineEnd() = default;
+
+    // drop queued elements and release blocked threads
+    virtual void abort() = 0;
+};
+
+class PipelineStageBase : public PipelineEnd {
+public:
+    virtual void start() = 0;
+    virtual void join() = 0;
+    virtual PipelineStageStats stats() const = 0;
+};
+
+/**
+ * @brief Puts items of an ordered stage back into sequence order
+ *
+ * Early items are parked and whichever worker completes the gap emits the
+ * run. Items at least window ahead of the next one wait before they are
+ * parked, so a slow consumer blocking the emitter holds the other workers
+ * back instead of letting the parked set grow. One worker is always left
+ * free while nobody emits, otherwise all of them could hold later items
+ * while the next one is still queued. After abort() items are dropped, as
+ * the one waiters wait for may never come.
+ */
+template <typename T>
+class Reorder {
+public:
+    Reorder(size_t window, size_t workers)
+        : window{window}
+        , workers{workers}
+    {
+    }
+
+    template <typename F>
+    void inOrder(uint64_t sequence, T&& item, F&& emit)
+    {
+        std::unique_lock<std::mutex> lock{mtx};
+        while (!stopped && sequence >= next + window && (emitting || waiting + 1 < workers)) {
+            ++waiting;
+            advanced.wait(lock);
+            --waiting;
+        }
+        if (stopped)
+            return;
+        pending.emplace(sequence, std::move(item));
+        peak = std::max(peak, pending.size());
+        if (emitting)
+            return;
+
+        // single emitter keeps the order, others only park their items
+        emitting = true;
+        while (!pending.empty() && pending.begin()->first == next) {
+            auto node = pending.extract(pending.begin());
+            ++next;
+            lock.unlock();
+            advanced.notify_all();
+            emit(std::move(node.mapped()));
+            lock.lock();
+        }
+        emitting = false;
+        // waiters which stayed for the emitter check whether one of them has to run free
+        advanced.notify_all();
+    }
+
+    void abort()
+    {
+        {
+            std::lock_guard<std::mutex> lock{mtx};
+            stopped = true;
+        }
+        advanced.notify_all();
+    }
+
+    size_t peakParked() const
+    {
+        std::lock_guard<std::mutex> lock{mtx};
+        return peak;
+    }
+
+private:
+    const size_t window;
+    const size_t workers;
+    mutable std::mutex mtx;
+    std::condition_variable advanced;
+    std::map<uint64_t, T> pending;
+    uint64_t next = 0;
+    bool emitting = false;
+    bool stopped = false;
+    size_t waiting = 0;
+    size_t peak = 0;
+};
+
+struct PipelineCore {
+    ~PipelineCore()
+    {
+        for (auto& stage : stages) {
+            stage->abort();
+        }
+        if (results)
+            results->abort();
+        for (auto& stage : stages) {
+            stage->join();
+        }
+    }
+
+    void fail(std::exception_ptr exception)
+    {
+        std::lock_guard<std::mutex> lock{errorMtx};
+        if (!error)
+            error = exception;
+    }
+
+    std::vector<std::unique_ptr<PipelineStageBase>> stages;
+    std::unique_ptr<PipelineEnd> results;
+    bool started = false;
+
+    std::mutex pushMtx;
+    uint64_t nextSequence = 0;
+
+    std::mutex errorMtx;
+    std::exception_ptr error;
+};
+
+struct NoOutput {
+};
+
+template <typename In, typename Out, size_t Capacity>
+class PipelineStage
+    : public PipelineStageBase
+    , public PipelineInput<In>
+    , public std::conditional_t<std::is_void<Out>::value, NoOutput, PipelineOutput<Out>> {
+    using Clock = std::chrono::steady_clock;
+
+public:
+    template <typename F>
+    PipelineStage(std::string name, size_t workers, F&& fun, StageOrder order, PipelineCore& core)
+        : name{std::move(name)}
+        , workers{std::max<size_t>(workers, 1)}
+        , function{std::forward<F>(fun)}
+        , ordered{order == StageOrder::Ordered}
+        , core{core}
+        , reorder{Capacity, this->workers}
+    {
+    }
+
+    bool push(PipelineItem<In>&& item)
+    {
+        // counted before, so workers never see it below zero
+        queued.fetch_add(1, std::memory_order_relaxed);
+        if (input.putWait(std::move(item)))
+            return true;
+        queued.fetch_sub(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    void finish()
+    {
+        input.disable();
+    }
+
+    void connect(PipelineInput<Out>* stage)
+    {
+        next = stage;
+    }
+
+    void start()
+    {
+        began = Clock::now();
+        running = workers;
+        pool = std::make_unique<ThreadPool>(workers);
+        for (size_t i = 0; i < workers; ++i) {
+            done.push_back(pool->addTask([this]() { work(); }));
+        }
+    }
+
+    void join()
+    {
+        for (auto& worker : done) {
+            worker.wait();
+        }
+        done.clear();
+        pool.reset();
+    }
+
+    void abort()
+    {
+        aborted = true;
+        input.disable();
+        reorder.abort();
+    }
+
+    PipelineStageStats stats() const
+    {
+        PipelineStageStats stats;
+        stats.name = name;
+        stats.workers = workers;
+        stats.processed = processed.load(std::memory_order_relaxed);
+        stats.failed = failed.load(std::memory_order_relaxed);
+        stats.busy = std::chrono::nanoseconds{busy.load(std::memory_order_relaxed)};
+        if (began != Clock::time_point{}) {
+            auto end = finished.load() != 0 ? Clock::time_point{Clock::duration{finished.load()}} : Clock::now();
+            stats.elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(end - began);
+        }
+        stats.capacity = Capacity;
+        stats.queued = queued.load(std::memory_order_relaxed);
+        stats.reorderPeak = reorder.peakParked();
+        if (stats.processed > 0)
+            stats.averageQueued = static_cast<double>(queuedSum.load(std::memory_order_relaxed)) / static_cast<double>(stats.processed);
+        return stats;
+    }
+
+private:
+    void work()
+    {
+        PipelineItem<In> item;
+        while (input.get(item)) {
+            auto depth = queued.fetch_sub(1, std::memory_order_relaxed);
+            queuedSum.fetch_add(static_cast<uint64_t>(std::max<int64_t>(depth, 0)), std::memory_order_relaxed);
+            if constexpr (std::is_void<Out>::value) {
+                // a sink has no result to reorder, the calls themselves are ordered
+                if (ordered)
+                    reorder.inOrder(item.sequence, std::move(item), [&](PipelineItem<In>&& parked) { consume(parked); });
+                else
+                    consume(item);
+            }
+            else {
+                PipelineItem<Out> result{item.sequence, std::nullopt};
+                if (item.value && !aborted)
+                    measure([&]() { result.value.emplace(function(std::move(*item.value))); });
+                if (ordered)
+                    reorder.inOrder(result.sequence, std::move(result), [&](PipelineItem<Out>&& ready) { next->push(std::move(ready)); });
+                else
+                    next->push(std::move(result));
+            }
+            processed.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        if (running.fetch_sub(1) == 1) {
+            finished = Clock::now().time_since_epoch().count();
+            if constexpr (!std::is_void<Out>::value)
+                next->finish();
+        }
+    }
+
+    void consume(PipelineItem<In>& item)
+    {
+        if (item.value && !aborted)
+            measure([&]() { function(std::move(*item.value)); });
+    }
+
+    template <typename F>
+    void measure(F&& call)
+    {
+        auto begin = Clock::now();
+        try {
+            call();
+        }
+        catch (...) {
+            failed.fetch_add(1, std::memory_order_relaxed);
+            core.fail(std::current_exception());
+        }
+        busy.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - begin).count(),
+            std::memory_order_relaxed);
+    }
+
+    std::string name;
+    size_t workers;
+    std::function<Out(In)> function;
+    bool ordered;
+    PipelineCore& core;
+    PipelineInput<Out>* next = nullptr;
+
+    ConditionBuffer<PipelineItem<In>, Capacity, BufferPolicy::Mpmc> input;
+    Reorder<std::conditional_t<std::is_void<Out>::value, PipelineItem<In>, PipelineItem<Out>>> reorder;
+    std::unique_ptr<ThreadPool> pool;
+    std::vector<std::future<void>> done;
+    std::atomic_bool aborted{false};
+    std::atomic_size_t running{0};
+
+    Clock::time_point began;
+    std::atomic<Clock::rep> finished{0};
+    std::atomic<uint64_t> processed{0};
+    std::atomic<uint64_t> failed{0};
+    std::atomic<int64_t> busy{0};
+    std::atomic<int64_t> queued{0};
+    std::atomic<uint64_t> queuedSum{0};
+};
+
+// buffer behind the last stage when it produces values
+template <typename T, size_t Capacity>
+class PipelineResults
+    : public PipelineEnd
+    , public PipelineInput<T> {
+public:
+    bool push(PipelineItem<T>&& item)
+    {
+        return buffer.putWait(std::move(item));
+    }
+
+    void finish()
+    {
+        buffer.disable();
+    }
+
+    void abort()
+    {
+        buffer.disable();
+    }
+
+    bool get(T& value)
+    {
+        PipelineItem<T> item;
+        while (buffer.get(item)) {
+            if (item.value) {
+                value = std::move(*item.value);
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    ConditionBuffer<PipelineItem<T>, Capacity, BufferPolicy::Mpmc> buffer;
+};
+} // namespace detail
+
+/**
+ * @brief Chain of stages connected by bounded buffers
+ *
+ * Every stage runs its function on its own workers and passes results to
+ * the next stage through a buffer of Capacity elements. A full buffer
+ * blocks the stage before it and finally push(), so a slow stage slows
+ * the whole pipeline down instead of letting queues grow.
+ *
+ * @code
+ * auto pipeline = Simple::Pipeline<std::string>{}
+ *     .stage("parse", 2, parse)
+ *     .stage("transform", 4, transform, Simple::StageOrder::Ordered)
+ *     .stage("write", 1, write);
+ * pipeline.start();
+ * for (auto& line : lines)
+ *     pipeline.push(line);
+ * pipeline.wait();
+ * @endcode
+ *
+ * An element on which a stage function throws is dropped, the first
+ * exception is rethrown by wait(). When the last stage returns values
+ * they are read with get().
+ */
+template <typename In, typename Out = In, size_t Capacity = 1024>
+class Pipeline {
+    using Results = std::conditional_t<std::is_void<Out>::value, void, detail::PipelineResults<Out, Capacity>>;
+
+public:
+    Pipeline()
+        : core{std::make_shared<detail::PipelineCore>()}
+    {
+        static_assert(std::is_same<In, Out>::value, "Pipeline starts without stages, Out must be In");
+    }
+
+    /**
+     * @brief Append stage calling fun on workers threads
+     *
+     * fun takes the result of the previous stage, or elements given to
+     * push() for the first one. A stage returning void ends the pipeline.
+     */
+    template <typename F>
+    auto stage(std::string name, size_t workers, F&& fun, StageOrder order = StageOrder::Unordered)
+        -> Pipeline<In, std::invoke_result_t<std::decay_t<F>&, Out>, Capacity>
+    {
+        static_assert(!std::is_void<Out>::value, "Stage returning void ends the pipeline");
+        using Result = std::invoke_result_t<std::decay_t<F>&, Out>;
+        if (core->started)
+            throw std::logic_error("Stages can not be added to running pipeline.");
+
+        auto stage = std::make_unique<detail::PipelineStage<Out, Result, Capacity>>(
+            std::move(name), workers, std::forward<F>(fun), order, *core);
+        Pipeline<In, Result, Capacity> extended{core, first};
+        if constexpr (!std::is_void<Result>::value)
+            extended.last = stage.get();
+
+        if (last != nullptr) {
+            last->connect(stage.get());
+        }
+        else if constexpr (std::is_same<In, Out>::value) {
+            extended.first = stage.get();
+        }
+        core->stages.push_back(std::move(stage));
+        return extended;
+    }
+
+    /**
+     * @brief Start workers of all stages
+     */
+    void start()
+    {
+        if (core->stages.empty())
+            throw std::logic_error("Pipeline has no stages.");
+        if (core->started)
+            throw std::logic_error("Pipeline already started.");
+
+        if constexpr (!std::is_void<Out>::value) {
+            auto buffer = std::make_unique<Results>();
+            results = buffer.get();
+            last->connect(results);
+            core->results = std::move(buffer);
+        }
+        for (auto& stage : core->stages) {
+            stage->start();
+        }
+        core->started = true;
+    }
+
+    /**
+     * @brief Feed element to the first stage, waits while its buffer is full
+     *
+     * @return false once the pipeline is disabled
+     */
+    bool push(In element)
+    {
+        if (!core->started)
+            throw std::logic_error("Pipeline is not started.");
+
+        // one sequence number per accepted element, ordered stages wait for each of them
+        std::lock_guard<std::mutex> lock{core->pushMtx};
+        if (!first->push(detail::PipelineItem<In>{core->nextSequence, std::move(element)}))
+            return false;
+        ++core->nextSequence;
+        return true;
+    }
+
+    /**
+     * @brief Take result of the last stage, waits while none is ready
+     *
+     * @return false once the pipeline is disabled and drained
+     */
+    template <typename T = Out>
+    std::enable_if_t<!std::is_void<T>::value, bool> get(T& result)
+    {
+        return results != nullptr && results->get(result);
+    }
+
+    /**
+     * @brief Stop accepting elements, those already pushed still pass all stages
+     */
+    void disable()
+    {
+        if (first != nullptr)
+            first->finish();
+    }
+
+    /**
+     * @brief Disable and wait until every stage finished
+     *
+     * When the last stage returns values somebody has to get() them,
+     * otherwise this waits for room forever. Rethrows the first exception
+     * of any stage function.
+     */
+    void wait()
+    {
+        disable();
+        for (auto& stage : core->stages) {
+            stage->join();
+        }
+
+        std::lock_guard<std::mutex> lock{core->errorMtx};
+        if (core->error)
+            std::rethrow_exception(std::exchange(core->error, nullptr));
+    }
+
+    std::vector<PipelineStageStats> stats() const
+    {
+        std::vector<PipelineStageStats> result;
+        for (auto& stage : core->stages) {
+            result.push_back(stage->stats());
+        }
+        return result;
+    }
+
+private:
+    template <typename, typename, size_t>
+    friend class Pipeline;
+
+    Pipeline(std::shared_ptr<detail::PipelineCore> core, detail::PipelineInput<In>* first)
+        : core{std::move(core)}
+        , first{first}
+    {
+    }
+
+    std::shared_ptr<detail::PipelineCore> core;
+    detail::PipelineInput<In>* first = nullptr;
+    detail::PipelineOutput<Out>* last = nullptr;
+    Results* results = nullptr;
+};
+} // namespace Simple
+
+#endif /* ifndef SIMPLE_PIPELINE_HPP */
@@ -0,0 +1,227 @@
+#ifndef SIMPLE_POOL_ALLOCATOR_HPP
+#define SIMPLE_POOL_ALLOCATOR_HPP
+
+#include <cstddef>
+#include <mutex>
+#include <new>
+
+namespace Simple {
+namespace detail {
+
+/**
+ * @brief Free list of equally sized blocks
+ *
+ * Every thread keeps a small cache of free blocks and exchanges batches
+ * with a shared depot, so blocks freed on another thread than they were
+ * allocated on flow back to the producer. Blocks are never returned to
+ * the system.
+ */
+template <size_t BlockSize>
+class BlockPool {
+    struct Node {
+        Node* next;
+    };
+
+    // thread local caches are plain data, they stay usable during thread teardown
+    struct Cache {
+        Node* head;
+        size_t count;
+        bool exited;
+    };
+
+    // hands cached blocks back to the depot when the thread exits
+    struct CacheGuard {
+        ~CacheGuard()
+        {
+            auto& c = cache();
+            depot().release(c.head, c.count);
+            c.head = nullptr;
+            c.count = 0;
+            c.exited = true;
+        }
+    };
+
+    static const size_t BatchSize = 32;
+    static const size_t CacheLimit = 2 * BatchSize;
+
+    std::mutex mtx;
+    Node* head = nullptr;
+
+public:
+    static void* allocate()
+    {
+        auto& c = cache();
+        if (c.head == nullptr) {
+            if (c.exited)
+                return depot().acquireOne();
+            registerGuard();
+            depot().acquire(c);
+        }
+        Node* node = c.head;
+        c.head = node->next;
+        --c.count;
+        return node;
+    }
+
+    static void deallocate(void* p)
+    {
+        auto& c = cache();
+        Node* node = static_cast<Node*>(p);
+        if (c.exited) {
+            depot().release(node, 1);
+            return;
+        }
+        registerGuard();
+        node->next = c.head;
+        c.head = node;
+        if (++c.count > CacheLimit) {
+            // keep half of the cache, return the rest to the depot
+            Node* first = c.head;
+            Node* last = first;
+            for (size_t i = 1; i < BatchSize; ++i) {
+                last = last->next;
+            }
+            c.head = last->next;
+            c.count -= BatchSize;
+            last->next = nullptr;
+            depot().release(first, BatchSize);
+        }
+    }
+
+private:
+    static BlockPool& depot()
+    {
+        // never destroyed, blocks may still be released during static destruction
+        static BlockPool* pool = new BlockPool;
+        return *pool;
+    }
+
+    static Cache& cache()
+    {
+        static thread_local Cache c{nullptr, 0, false};
+        return c;
+    }
+
+    static void registerGuard()
+    {
+        static thread_local CacheGuard guard;
+        (void)guard;
+    }
+
+    void acquire(Cache& c)
+    {
+        std::lock_guard<std::mutex> lock{mtx};
+        if (head == nullptr)
+            allocateBatch();
+        for (size_t i = 0; i < BatchSize && head != nullptr; ++i) {
+            Node* node = head;
+            head = node->next;
+            node->next = c.head;
+            c.head = node;
+            ++c.count;
+        }
+    }
+
+    void* acquireOne()
+    {
+        std::lock_guard<std::mutex> lock{mtx};
+        if (head == nullptr)
+            allocateBatch();
+        Node* node = head;
+        head = node->next;
+        return node;
+    }
+
+    // list is terminated by nullptr, count is the number of nodes in it
+    void release(Node* first, size_t count)
+    {
+        if (first == nullptr)
+            return;
+        Node* last = first;
+        for (size_t i = 1; i < count; ++i) {
+            last = last->next;
+        }
+        std::lock_guard<std::mutex> lock{mtx};
+        last->next = head;
+        head = first;
+    }
+
+    void allocateBatch()
+    {
+        auto* memory = static_cast<unsigned char*>(::operator new(BlockSize * BatchSize));
+        for (size_t i = 0; i < BatchSize; ++i) {
+            Node* node = reinterpret_cast<Node*>(memory + i * BlockSize);
+            node->next = head;
+            head = node;
+        }
+    }
+};
+} // namespace detail
+
+/**
+ * @brief Stateless allocator serving single objects from per size free lists
+ *
+ * Objects up to MaxBlockSize bytes are recycled, everything else goes
+ * straight to the global operator new.
+ */
+template <typename T>
+class PoolAllocator {
+public:
+    using value_type = T;
+
+    static const size_t MaxBlockSize = 256;
+
+    PoolAllocator() noexcept = default;
+
+    template <typename U>
+    PoolAllocator(const PoolAllocator<U>&) noexcept
+    {
+    }
+
+    T* allocate(size_t n)
+    {
+        if constexpr (pooled()) {
+            if (n == 1)
+                return static_cast<T*>(detail::BlockPool<blockSize()>::allocate());
+        }
+        return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T* p, size_t n) noexcept
+    {
+        if constexpr (pooled()) {
+            if (n == 1) {
+                detail::BlockPool<blockSize()>::deallocate(p);
+                return;
+            }
+        }
+        ::operator delete(p);
+    }
+
+    template <typename U>
+    bool operator==(const PoolAllocator<U>&) const noexcept
+    {
+        return true;
+    }
+
+    template <typename U>
+    bool operator!=(const PoolAllocator<U>&) const noexcept
+    {
+        return false;
+    }
+
+private:
+    static constexpr bool pooled()
+    {
+        return sizeof(T) <= MaxBlockSize && alignof(T) <= alignof(std::max_align_t);
+    }
+
+    // size classes are multiples of the fundamental alignment
+    static constexpr size_t blockSize()
+    {
+        return (sizeof(T) + alignof(std::max_align_t) - 1) / alignof(std::max_align_t) * alignof(std::max_align_t);
+    }
+};
+} // namespace Simple
+
+#endif /* ifndef SIMPLE_POOL_ALLOCATOR_HPP */
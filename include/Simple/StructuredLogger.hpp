@@ -0,0 +1,343 @@
+#ifndef SIMPLE_STRUCTURED_LOGGER_HPP
+#define SIMPLE_STRUCTURED_LOGGER_HPP
+
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+#include "Logger.hpp"
+
+namespace Simple {
+
+/**
+ * @brief How LOG_RECORD lines are written
+ */
+enum class LogRecordFormat {
+    // {"time":"...","level":"INFO","msg":"...","key":value}
+    Json,
+    // time="..." level=INFO msg=... key=value
+    Logfmt
+};
+
+namespace detail {
+
+template <typename T = void>
+struct RuntimeRecordFormat {
+    static std::atomic<int> value;
+};
+
+template <typename T>
+std::atomic<int> RuntimeRecordFormat<T>::value{static_cast<int>(LogRecordFormat::Json)};
+
+inline LogRecordFormat recordFormat()
+{
+    return static_cast<LogRecordFormat>(RuntimeRecordFormat<>::value.load(std::memory_order_relaxed));
+}
+
+inline const char* levelName(int level)
+{
+    static const char* const levels[] = {"ERROR", "WARNING", "INFO", "DEBUG", "TRACE"};
+    return levels[level];
+}
+
+// JSON string with quotes, runs of characters which need no escape are copied at once
+inline void appendJsonString(LogBuffer& out, const char* text, std::size_t size)
+{
+    static const char hex[] = "0123456789abcdef";
+    out.append('"');
+    std::size_t begin = 0;
+    for (std::size_t i = 0; i < size; ++i) {
+        auto c = static_cast<unsigned char>(text[i]);
+        if (c >= 0x20 && c != '"' && c != '\\')
+            continue;
+        out.append(text + begin, i - begin);
+        begin = i + 1;
+        switch (c) {
+        case '"':
+            out.append("\\\"", 2);
+            break;
+        case '\\':
+            out.append("\\\\", 2);
+            break;
+        case '\n':
+            out.append("\\n", 2);
+            break;
+        case '\r':
+            out.append("\\r", 2);
+            break;
+        case '\t':
+            out.append("\\t", 2);
+            break;
+        default:
+            char escaped[] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xf]};
+            out.append(escaped, sizeof(escaped));
+        }
+    }
+    out.append(text + begin, size - begin);
+    out.append('"');
+}
+
+// bare when it cannot be mistaken for something else, quoted and escaped otherwise
+inline void appendLogfmtString(LogBuffer& out, const char* text, std::size_t size)
+{
+    bool quote = size == 0;
+    for (std::size_t i = 0; i < size && !quote; ++i) {
+        auto c = static_cast<unsigned char>(text[i]);
+        quote = c <= ' ' || c == '=' || c == '"' || c == '\\';
+    }
+    if (!quote) {
+        out.append(text, size);
+        return;
+    }
+    // logfmt readers accept the escapes of JSON strings
+    appendJsonString(out, text, size);
+}
+
+inline void appendString(LogBuffer& out, LogRecordFormat format, const char* text, std::size_t size)
+{
+    if (format == LogRecordFormat::Json)
+        appendJsonString(out, text, size);
+    else
+        appendLogfmtString(out, text, size);
+}
+
+// ,"key": or  key=
+inline void appendKey(LogBuffer& out, LogRecordFormat format, const char* key)
+{
+    if (format == LogRecordFormat::Json) {
+        out.append(',');
+        appendJsonString(out, key, std::strlen(key));
+        out.append(':');
+    }
+    else {
+        out.append(' ');
+        out.append(key, std::strlen(key));
+        out.append('=');
+    }
+}
+
+inline void appendValue(LogBuffer& out, LogRecordFormat format, const char* text)
+{
+    appendString(out, format, text, text ? std::strlen(text) : 0);
+}
+
+inline void appendValue(LogBuffer& out, LogRecordFormat format, const std::string& text)
+{
+    appendString(out, format, text.data(), text.size());
+}
+
+#if (__cplusplus >= 201703L) || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L)
+inline void appendValue(LogBuffer& out, LogRecordFormat format, std::string_view text)
+{
+    appendString(out, format, text.data(), text.size());
+}
+#endif
+
+inline void appendValue(LogBuffer& out, LogRecordFormat format, char c)
+{
+    appendString(out, format, &c, 1);
+}
+
+inline void appendValue(LogBuffer& out, LogRecordFormat /*format*/, bool value)
+{
+    if (value)
+        out.append("true", 4);
+    else
+        out.append("false", 5);
+}
+
+template <class T>
+typename std::enable_if<std::is_integral<T>::value>::type appendValue(LogBuffer& out, LogRecordFormat /*format*/,
+                                                                       T value)
+{
+    char digits[IntegerDigits];
+    char* end = digits + sizeof(digits);
+    char* begin = formatInteger(end, value, std::is_signed<T>());
+    out.append(begin, static_cast<std::size_t>(end - begin));
+}
+
+// the shortest text which reads back as the same value, JSON has no infinity or NaN
+template <class T>
+typename std::enable_if<std::is_floating_point<T>::value>::type appendValue(LogBuffer& out, LogRecordFormat format,
+                                                                             T value)
+{
+    char digits[64];
+    std::size_t size;
+#if defined(__cpp_lib_to_chars)
+    size = static_cast<std::size_t>(std::to_chars(digits, digits + sizeof(digits), value).ptr - digits);
+#else
+    // 15 digits read back as the same value most of the time, 17 always do
+    int written = std::snprintf(digits, sizeof(digits), "%.15g", static_cast<double>(value));
+    if (std::strtod(digits, nullptr) != static_cast<double>(value))
+        written = std::snprintf(digits, sizeof(digits), "%.17g", static_cast<double>(value));
+    size = written < 0 ? 0 : static_cast<std::size_t>(written);
+#endif
+    if (format == LogRecordFormat::Json && !std::isfinite(value))
+        appendJsonString(out, digits, size);
+    else
+        out.append(digits, size);
+}
+
+// other values are written with their operator<< and logged as strings
+template <class T>
+typename std::enable_if<!std::is_arithmetic<T>::value>::type appendValue(LogBuffer& out, LogRecordFormat format,
+                                                                          const T& value)
+{
+    LogBuffer text;
+    LogStream os;
+    os.attach(text);
+    os << value;
+    os.detach();
+    appendString(out, format, text.data(), text.size());
+}
+
+// the context fields of the scopes a thread is in, serialized for both formats
+struct RecordContext {
+    LogBuffer json;
+    LogBuffer logfmt;
+};
+
+inline RecordContext& recordContext()
+{
+    static thread_local RecordContext context;
+    return context;
+}
+
+} // namespace detail
+
+/**
+ * @brief Fields added to every LOG_RECORD of the thread while the context is alive
+ *
+ * The fields are serialized once, when the context is created, and records
+ * copy them as they are. Contexts nest and have to end in reverse order,
+ * as scopes do.
+ *
+ *     Simple::LogContext context("service", "billing", "request", requestId);
+ *     LOG_RECORD(Simple::LogLevel::Info, "charged").field("amount", 12.5);
+ */
+class LogContext {
+public:
+    template <class... Fields>
+    explicit LogContext(const Fields&... fields)
+    {
+        static_assert(sizeof...(Fields) % 2 == 0, "fields are key and value pairs");
+        auto& context = detail::recordContext();
+        jsonSize = context.json.size();
+        logfmtSize = context.logfmt.size();
+        add(context, fields...);
+    }
+
+    LogContext(const LogContext&) = delete;
+    LogContext& operator=(const LogContext&) = delete;
+
+    ~LogContext()
+    {
+        auto& context = detail::recordContext();
+        context.json.truncate(jsonSize);
+        context.logfmt.truncate(logfmtSize);
+    }
+
+private:
+    void add(detail::RecordContext&) {}
+
+    template <class T, class... Fields>
+    void add(detail::RecordContext& context, const char* key, const T& value, const Fields&... fields)
+    {
+        detail::appendKey(context.json, LogRecordFormat::Json, key);
+        detail::appendValue(context.json, LogRecordFormat::Json, value);
+        detail::appendKey(context.logfmt, LogRecordFormat::Logfmt, key);
+        detail::appendValue(context.logfmt, LogRecordFormat::Logfmt, value);
+        add(context, fields...);
+    }
+
+    std::size_t jsonSize;
+    std::size_t logfmtSize;
+};
+
+/**
+ * @brief One structured line, written through Logger like the lines of LOG
+ *
+ * Time, level, message and the fields of the thread's contexts come first,
+ * then the fields of the statement in the order they were added.
+ */
+class LogRecord {
+public:
+    LogRecord(int level, const char* message)
+        : format(detail::recordFormat())
+    {
+        char prefix[32];
+        auto size = formatNowTime(prefix, time);
+        const char* name = detail::levelName(level);
+        auto& context = detail::recordContext();
+        if (format == LogRecordFormat::Json) {
+            buffer.append("{\"time\":\"", 9);
+            buffer.append(prefix, size);
+            buffer.append("\",\"level\":\"", 11);
+            buffer.append(name, std::strlen(name));
+            buffer.append("\",\"msg\":", 8);
+            detail::appendJsonString(buffer, message, std::strlen(message));
+            buffer.append(context.json.data(), context.json.size());
+        }
+        else {
+            buffer.append("time=\"", 6);
+            buffer.append(prefix, size);
+            buffer.append("\" level=", 8);
+            buffer.append(name, std::strlen(name));
+            buffer.append(" msg=", 5);
+            detail::appendLogfmtString(buffer, message, std::strlen(message));
+            buffer.append(context.logfmt.data(), context.logfmt.size());
+        }
+    }
+
+    LogRecord(const LogRecord&) = delete;
+    LogRecord& operator=(const LogRecord&) = delete;
+
+    template <class T>
+    LogRecord& field(const char* key, const T& value)
+    {
+        detail::appendKey(buffer, format, key);
+        detail::appendValue(buffer, format, value);
+        return *this;
+    }
+
+    ~LogRecord()
+    {
+        if (format == LogRecordFormat::Json)
+            buffer.append('}');
+        Simple::Logger::getInstance()->writeStream(std::move(buffer), time);
+    }
+
+    /**
+     * @brief Format of the records that start from now on
+     */
+    static void setFormat(LogRecordFormat format)
+    {
+        detail::RuntimeRecordFormat<>::value.store(static_cast<int>(format), std::memory_order_relaxed);
+    }
+
+private:
+    const LogRecordFormat format;
+    LogBuffer buffer;
+    std::uint64_t time = 0;
+};
+
+} // namespace Simple
+
+/**
+ * LOG_RECORD(level, "message").field("key", value)...
+ *
+ * The level is filtered like LOG(level), fields are neither formatted nor
+ * evaluated when the record is not written.
+ */
+#define LOG_RECORD(level, message)                                                                                     \
+    if (level > SIMPLE_LOGGER_MAX_LEVEL || level > Simple::Logger::currentLevel())                                     \
+        ;                                                                                                              \
+    else                                                                                                               \
+        Simple::LogRecord(level, message)
+
+#endif // SIMPLE_STRUCTURED_LOGGER_HPP
@@ -0,0 +1,172 @@
+#ifndef SIMPLE_TASK_FUNCTION_HPP
+#define SIMPLE_TASK_FUNCTION_HPP
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace Simple {
+
+/**
+ * @brief Move-only replacement of std::function<void()>
+ *
+ * Callables up to InlineSize bytes are stored inside the object itself,
+ * bigger ones fall back to the heap. Unlike std::function the callable
+ * does not need to be copyable, so it can own a std::promise.
+ */
+class TaskFunction {
+public:
+    // together with the operations pointer the task fills one cache line
+    static constexpr size_t InlineSize = 64 - sizeof(void*);
+
+    TaskFunction() noexcept = default;
+
+    TaskFunction(std::nullptr_t) noexcept
+    {
+    }
+
+    template <typename F, typename = std::enable_if_t<!std::is_same<std::decay_t<F>, TaskFunction>::value>>
+    TaskFunction(F&& fun)
+    {
+        using Functor = std::decay_t<F>;
+        if constexpr (fitsInline<Functor>()) {
+            new (&storage) Functor(std::forward<F>(fun));
+            ops = &InlineOps<Functor>::operations;
+        }
+        else {
+            new (&storage) Functor*(new Functor(std::forward<F>(fun)));
+            ops = &HeapOps<Functor>::operations;
+        }
+    }
+
+    TaskFunction(TaskFunction&& other) noexcept
+    {
+        moveFrom(other);
+    }
+
+    TaskFunction& operator=(TaskFunction&& other) noexcept
+    {
+        if (this != &other) {
+            reset();
+            moveFrom(other);
+        }
+        return *this;
+    }
+
+    TaskFunction& operator=(std::nullptr_t) noexcept
+    {
+        reset();
+        return *this;
+    }
+
+    TaskFunction(const TaskFunction&) = delete;
+    TaskFunction& operator=(const TaskFunction&) = delete;
+
+    ~TaskFunction()
+    {
+        reset();
+    }
+
+    void operator()()
+    {
+        ops->invoke(&storage);
+    }
+
+    explicit operator bool() const noexcept
+    {
+        return ops != nullptr;
+    }
+
+    bool operator==(std::nullptr_t) const noexcept
+    {
+        return ops == nullptr;
+    }
+
+    bool operator!=(std::nullptr_t) const noexcept
+    {
+        return ops != nullptr;
+    }
+
+    void reset() noexcept
+    {
+        if (ops != nullptr) {
+            ops->destroy(&storage);
+            ops = nullptr;
+        }
+    }
+
+    /**
+     * @brief Whether callable of type F is stored without heap allocation
+     */
+    template <typename F>
+    static constexpr bool fitsInline()
+    {
+        return sizeof(F) <= InlineSize && alignof(F) <= alignof(std::max_align_t)
+               && std::is_nothrow_move_constructible<F>::value;
+    }
+
+private:
+    struct Operations {
+        void (*invoke)(void*);
+        // move construct into destination and destroy source
+        void (*relocate)(void* src, void* dst) noexcept;
+        void (*destroy)(void*) noexcept;
+    };
+
+    template <typename F>
+    struct InlineOps {
+        static void invoke(void* p)
+        {
+            (*static_cast<F*>(p))();
+        }
+
+        static void relocate(void* src, void* dst) noexcept
+        {
+            new (dst) F(std::move(*static_cast<F*>(src)));
+            static_cast<F*>(src)->~F();
+        }
+
+        static void destroy(void* p) noexcept
+        {
+            static_cast<F*>(p)->~F();
+        }
+
+        static constexpr Operations operations{&invoke, &relocate, &destroy};
+    };
+
+    template <typename F>
+    struct HeapOps {
+        static void invoke(void* p)
+        {
+            (**static_cast<F**>(p))();
+        }
+
+        static void relocate(void* src, void* dst) noexcept
+        {
+            new (dst) F*(*static_cast<F**>(src));
+        }
+
+        static void destroy(void* p) noexcept
+        {
+            delete *static_cast<F**>(p);
+        }
+
+        static constexpr Operations operations{&invoke, &relocate, &destroy};
+    };
+
+    void moveFrom(TaskFunction& other) noexcept
+    {
+        if (other.ops != nullptr) {
+            other.ops->relocate(&other.storage, &storage);
+            ops = other.ops;
+            other.ops = nullptr;
+        }
+    }
+
+    alignas(std::max_align_t) unsigned char storage[InlineSize];
+    const Operations* ops = nullptr;
+};
+} // namespace Simple
+
+#endif /* ifndef SIMPLE_TASK_FUNCTION_HPP */
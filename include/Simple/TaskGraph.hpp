@@ -0,0 +1,188 @@
+#ifndef SIMPLE_TASK_GRAPH_HPP
+#define SIMPLE_TASK_GRAPH_HPP
+
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+#include "Future.hpp"
+#include "TaskFunction.hpp"
+#include "ThreadPool.hpp"
+
+namespace Simple {
+
+/**
+ * @brief Directed acyclic graph of tasks
+ *
+ * Every task is posted to the pool only after all its dependencies
+ * finished, so no worker ever waits for another task. Data flows between
+ * tasks through their captures.
+ */
+class TaskGraph {
+public:
+    using Node = size_t;
+
+    /**
+     * @brief Add task, fun is called without arguments every time the graph runs
+     */
+    template <typename F>
+    Node add(F&& fun)
+    {
+        nodes.push_back(NodeData{TaskFunction{std::forward<F>(fun)}, {}, 0});
+        return nodes.size() - 1;
+    }
+
+    /**
+     * @brief Run node only after dependency finished
+     */
+    void addDependency(Node node, Node dependency)
+    {
+        if (node >= nodes.size() || dependency >= nodes.size())
+            throw std::out_of_range("Node is not part of the graph.");
+        nodes[dependency].successors.push_back(node);
+        ++nodes[node].dependencies;
+    }
+
+    size_t size() const
+    {
+        return nodes.size();
+    }
+
+    /**
+     * @brief Run all tasks on pool in dependency order
+     *
+     * After a task throws, tasks which did not start yet are skipped and the
+     * returned future holds the first exception. The graph must not be
+     * changed or destroyed before the returned future is ready.
+     *
+     * Throws std::logic_error when the dependencies contain a cycle.
+     */
+    Future<void> run(ThreadPool& pool)
+    {
+        if (hasCycle())
+            throw std::logic_error("Task graph contains a cycle.");
+
+        auto execution = std::make_shared<Execution>(*this, pool);
+        auto future = execution->promise.getFuture(&pool);
+        if (nodes.empty()) {
+            execution->promise.setValue();
+            return future;
+        }
+
+        for (Node node = 0; node < nodes.size(); ++node) {
+            if (nodes[node].dependencies == 0)
+                schedule(execution, node);
+        }
+        return future;
+    }
+
+private:
+    struct NodeData {
+        TaskFunction fun;
+        std::vector<Node> successors;
+        size_t dependencies;
+    };
+
+    struct Execution {
+        Execution(TaskGraph& graph, ThreadPool& pool)
+            : graph{graph}
+            , pool{pool}
+            , waiting{new std::atomic_size_t[graph.nodes.size()]}
+            , remaining{graph.nodes.size()}
+        {
+            for (Node node = 0; node < graph.nodes.size(); ++node) {
+                waiting[node] = graph.nodes[node].dependencies;
+            }
+        }
+
+        TaskGraph& graph;
+        ThreadPool& pool;
+        std::unique_ptr<std::atomic_size_t[]> waiting;
+        std::atomic_size_t remaining;
+        std::atomic_bool failed{false};
+        std::mutex mtx;
+        std::exception_ptr error;
+        Promise<void> promise;
+    };
+
+    static void schedule(const std::shared_ptr<Execution>& execution, Node node)
+    {
+        execution->pool.post([execution, node]() { runFrom(execution, node); });
+    }
+
+    // runs node and keeps going with one of the successors it released, the others are posted
+    static void runFrom(const std::shared_ptr<Execution>& execution, Node node)
+    {
+        auto& nodes = execution->graph.nodes;
+        while (true) {
+            if (!execution->failed) {
+                try {
+                    nodes[node].fun();
+                }
+                catch (...) {
+                    std::lock_guard<std::mutex> lock{execution->mtx};
+                    if (!execution->error)
+                        execution->error = std::current_exception();
+                    execution->failed = true;
+                }
+            }
+
+            bool hasNext = false;
+            Node next = 0;
+            for (Node successor : nodes[node].successors) {
+                if (--execution->waiting[successor] != 0)
+                    continue;
+                if (hasNext)
+                    schedule(execution, next);
+                next = successor;
+                hasNext = true;
+            }
+
+            if (--execution->remaining == 0)
+                finish(*execution);
+            if (!hasNext)
+                return;
+            node = next;
+        }
+    }
+
+    static void finish(Execution& execution)
+    {
+        if (execution.error)
+            execution.promise.setException(execution.error);
+        else
+            execution.promise.setValue();
+    }
+
+    // Kahn's algorithm, every node gets visited only when the graph is acyclic
+    bool hasCycle() const
+    {
+        std::vector<size_t> waiting(nodes.size());
+        std::vector<Node> ready;
+        for (Node node = 0; node < nodes.size(); ++node) {
+            waiting[node] = nodes[node].dependencies;
+            if (waiting[node] == 0)
+                ready.push_back(node);
+        }
+
+        size_t visited = 0;
+        while (!ready.empty()) {
+            Node node = ready.back();
+            ready.pop_back();
+            ++visited;
+            for (Node successor : nodes[node].successors) {
+                if (--waiting[successor] == 0)
+                    ready.push_back(successor);
+            }
+        }
+        return visited != nodes.size();
+    }
+
+    std::vector<NodeData> nodes;
+};
+} // namespace Simple
+
+#endif /* ifndef SIMPLE_TASK_GRAPH_HPP */
@@ -1,39 +1,418 @@
 #ifndef SIMPLE_THREADPOOL_HPP
 #define SIMPLE_THREADPOOL_HPP
 
+#include <algorithm>
+#include <array>
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
-#include <functional>
+#include <cstdint>
 #include <future>
+#include <memory>
 #include <mutex>
-#include <queue>
+#include <thread>
+#include <tuple>
+#include <type_traits>
 #include <vector>
 
+#ifdef __cpp_impl_coroutine
+#include <coroutine>
+#endif
+
+#include "Affinity.hpp"
+#include "LatencyHistogram.hpp"
+#include "PoolAllocator.hpp"
+#include "TaskFunction.hpp"
+
 namespace Simple {
+
+/**
+ * @brief How ThreadPool distributes tasks between its workers
+ */
+enum class Scheduling {
+    // every worker takes tasks from one shared queue
+    GlobalQueue,
+    // every worker owns a deque, idle workers steal from the others
+    WorkStealing
+};
+
+/**
+ * @brief What idle workers do before blocking on the condition variable
+ */
+enum class IdlePolicy {
+    // block right away
+    Park,
+    // busy wait for spinDuration, then block
+    Spin,
+    // yield the CPU in a loop for spinDuration, then block
+    Yield
+};
+
+/**
+ * @brief Scheduling class of a task
+ *
+ * High tasks are served earliest deadline first, tasks added with
+ * priority High are due at the time they were added.
+ */
+enum class TaskPriority { High, Normal, Low };
+
+namespace detail {
+
+/**
+ * @brief Double ended queue on top of growable ring buffer
+ *
+ * Storage only grows, so once the queue reached its working size pushing
+ * and popping does not allocate anymore.
+ */
+template <typename T>
+class RingDeque {
+public:
+    bool empty() const
+    {
+        return count == 0;
+    }
+
+    size_t size() const
+    {
+        return count;
+    }
+
+    void push_back(T&& value)
+    {
+        if (count == items.size())
+            grow();
+        items[(head + count) & (items.size() - 1)] = std::move(value);
+        ++count;
+    }
+
+    T pop_front()
+    {
+        T value = std::move(items[head]);
+        head = (head + 1) & (items.size() - 1);
+        --count;
+        return value;
+    }
+
+    T pop_back()
+    {
+        --count;
+        return std::move(items[(head + count) & (items.size() - 1)]);
+    }
+
+private:
+    void grow()
+    {
+        std::vector<T> bigger(std::max<size_t>(items.size() * 2, 16));
+        for (size_t i = 0; i < count; ++i) {
+            bigger[i] = std::move(items[(head + i) & (items.size() - 1)]);
+        }
+        items.swap(bigger);
+        head = 0;
+    }
+
+    std::vector<T> items;
+    size_t head = 0;
+    size_t count = 0;
+};
+
+/**
+ * @brief One queue per TaskPriority
+ *
+ * High tasks are kept in a heap ordered by deadline, Normal and Low ones
+ * in FIFO order.
+ */
+template <typename T>
+class PriorityQueues {
+    using TimePoint = std::chrono::steady_clock::time_point;
+
+    struct Entry {
+        TimePoint deadline;
+        uint64_t sequence;
+        T task;
+    };
+
+    static bool later(const Entry& a, const Entry& b)
+    {
+        return a.deadline > b.deadline || (a.deadline == b.deadline && a.sequence > b.sequence);
+    }
+
+public:
+    bool empty() const
+    {
+        return high.empty() && normal.empty() && low.empty();
+    }
+
+    bool empty(TaskPriority priority) const
+    {
+        switch (priority) {
+        case TaskPriority::High:
+            return high.empty();
+        case TaskPriority::Normal:
+            return normal.empty();
+        default:
+            return low.empty();
+        }
+    }
+
+    void push(TaskPriority priority, TimePoint deadline, T&& task)
+    {
+        switch (priority) {
+        case TaskPriority::High:
+            high.push_back(Entry{deadline, sequence++, std::move(task)});
+            std::push_heap(high.begin(), high.end(), later);
+            break;
+        case TaskPriority::Normal:
+            normal.push_back(std::move(task));
+            break;
+        default:
+            low.push_back(std::move(task));
+            break;
+        }
+    }
+
+    T pop(TaskPriority priority)
+    {
+        switch (priority) {
+        case TaskPriority::High: {
+            std::pop_heap(high.begin(), high.end(), later);
+            T task = std::move(high.back().task);
+            high.pop_back();
+            return task;
+        }
+        case TaskPriority::Normal:
+            return normal.pop_front();
+        default:
+            return low.pop_front();
+        }
+    }
+
+private:
+    std::vector<Entry> high;
+    RingDeque<T> normal;
+    RingDeque<T> low;
+    uint64_t sequence = 0;
+};
+
+/**
+ * @brief Smooth weighted round robin between priority classes
+ *
+ * Every class with queued work gets picked proportionally to its weight,
+ * so no class starves while the others are busy.
+ */
+class PriorityPicker {
+public:
+    explicit PriorityPicker(const std::array<unsigned, 3>& weights)
+        : weights{weights}
+    {
+    }
+
+    // returns false when nothing is available
+    bool pick(const std::array<bool, 3>& available, TaskPriority& chosen)
+    {
+        long total = 0;
+        int best = -1;
+        for (int c = 0; c < 3; ++c) {
+            if (!available[c])
+                continue;
+            current[c] += weights[c];
+            total += weights[c];
+            if (best < 0 || current[c] > current[best])
+                best = c;
+        }
+        if (best < 0)
+            return false;
+
+        current[best] -= total;
+        chosen = static_cast<TaskPriority>(best);
+        return true;
+    }
+
+private:
+    std::array<unsigned, 3> weights;
+    std::array<long, 3> current{{0, 0, 0}};
+};
+
+inline void cpuRelax()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+// written only by the worker owning them
+struct WorkerCounters {
+    std::atomic<uint64_t> tasks{0};
+    std::atomic<uint64_t> steals{0};
+    std::atomic<uint64_t> busyNanoseconds{0};
+    ConcurrentHistogram queueTime;
+    ConcurrentHistogram runTime;
+};
+} // namespace detail
+
+struct ThreadPoolOptions {
+    // workers that are kept alive even when idle
+    size_t minThreads = std::thread::hardware_concurrency();
+    // upper bound of workers, once reached tasks are queued
+    size_t maxThreads = std::thread::hardware_concurrency();
+    // surplus workers exit after being idle for this long
+    std::chrono::milliseconds idleTimeout = std::chrono::seconds{30};
+    Scheduling scheduling = Scheduling::GlobalQueue;
+    // relative share of picks for High, Normal and Low tasks while all of them are queued
+    std::array<unsigned, 3> priorityWeights{{8, 4, 1}};
+    // pin workers to CPUs, worker slot i always gets the same CPU
+    Placement placement = Placement::None;
+    // CPUs workers may be pinned to, empty means all CPUs of the process
+    std::vector<unsigned> cpus;
+    // collect per worker counters and latency histograms, see ThreadPool::stats()
+    bool instrumentation = false;
+    IdlePolicy idlePolicy = IdlePolicy::Park;
+    // how long Spin and Yield policies look for work before blocking
+    std::chrono::microseconds spinDuration{50};
+};
+
+/**
+ * @brief Snapshot of ThreadPool counters
+ *
+ * Counters only grow, the difference of two snapshots describes the
+ * interval between them.
+ */
+struct ThreadPoolStats {
+    struct Worker {
+        uint64_t tasks = 0;
+        // tasks taken from deques of other workers
+        uint64_t steals = 0;
+        // time spent running tasks
+        std::chrono::nanoseconds busy{0};
+    };
+
+    // time since the pool was created
+    std::chrono::nanoseconds elapsed{0};
+    // one entry per worker slot
+    std::vector<Worker> workers;
+    // waiting tasks per TaskPriority
+    std::array<size_t, 3> queueDepth{};
+    // time between submission and start of a task
+    LatencyHistogram queueTime;
+    // time a task was running
+    LatencyHistogram runTime;
+
+    uint64_t tasks() const
+    {
+        uint64_t total = 0;
+        for (auto& worker : workers) {
+            total += worker.tasks;
+        }
+        return total;
+    }
+
+    /**
+     * @brief Busy share of all worker slots since creation of the pool, from 0 to 1
+     */
+    double utilization() const
+    {
+        if (elapsed.count() <= 0 || workers.empty())
+            return 0.0;
+        std::chrono::nanoseconds busy{0};
+        for (auto& worker : workers) {
+            busy += worker.busy;
+        }
+        return static_cast<double>(busy.count()) / (static_cast<double>(elapsed.count()) * workers.size());
+    }
+};
+
 class ThreadPool {
-    using ThreadTask = std::function<void()>;
-    using TaskBuffer = std::queue<ThreadTask>;
+    struct ThreadTask {
+        TaskFunction fun;
+        // submission time, only set with instrumentation enabled
+        std::chrono::steady_clock::time_point queued;
+    };
+    using TaskBuffer = detail::RingDeque<ThreadTask>;
     using Lock = std::unique_lock<std::mutex>;
 
+    struct Worker {
+        std::thread thread;
+        // guarded by workersMtx
+        bool active = false;
+        // local deque used in WorkStealing mode
+        std::mutex mtx;
+        TaskBuffer tasks;
+        // NUMA node of the CPU the worker is pinned to
+        size_t node = 0;
+        // workers to steal from, the ones on the same node first
+        std::vector<size_t> victims;
+        // only allocated with instrumentation enabled
+        std::unique_ptr<detail::WorkerCounters> counters;
+    };
+
+    struct WorkerContext {
+        ThreadPool* pool = nullptr;
+        size_t index = 0;
+    };
+
 public:
+    using Clock = std::chrono::steady_clock;
+
     ThreadPool()
-        : shouldRun{true}
+        : ThreadPool(ThreadPoolOptions{})
     {
-        createThreads(std::thread::hardware_concurrency());
     }
 
-    ThreadPool(size_t size)
+    /**
+     * @brief Create pool with fixed number of workers
+     *
+     * @param size
+     * @param scheduling
+     */
+    ThreadPool(size_t size, Scheduling scheduling = Scheduling::GlobalQueue)
+        : ThreadPool(fixedSize(size, scheduling))
+    {
+    }
+
+    /**
+     * @brief Create pool which keeps between minThreads and maxThreads workers
+     *
+     * New workers are started only while none is idle and maxThreads is not
+     * reached, otherwise tasks wait in the queue. Workers above minThreads
+     * exit after idleTimeout without work.
+     *
+     * In WorkStealing mode tasks added from a worker go to its own deque and
+     * idle workers steal from the others. With placement set, workers are
+     * pinned to CPUs, tasks from other threads go to a worker on the
+     * submitter's NUMA node and thieves try their own node first.
+     *
+     * @param options
+     */
+    explicit ThreadPool(const ThreadPoolOptions& options)
         : shouldRun{true}
+        , scheduling{options.scheduling}
+        , minThreads{std::min(options.minThreads, std::max<size_t>(options.maxThreads, 1))}
+        , idleTimeout{options.idleTimeout}
+        , priorityWeights{options.priorityWeights}
+        , instrumented{options.instrumentation}
+        , idlePolicy{options.idlePolicy}
+        , spinDuration{options.spinDuration}
+        , created{Clock::now()}
     {
-        createThreads(size);
+        for (auto& weight : priorityWeights) {
+            weight = std::max(weight, 1u);
+        }
+        if (options.placement != Placement::None)
+            cpuOrder = NumaTopology::instance().placementOrder(options.placement, options.cpus);
+        createThreads(std::max<size_t>(options.maxThreads, 1));
     }
 
     ~ThreadPool()
     {
-        shouldRun = false;
+        {
+            Lock lock{mtx};
+            shouldRun = false;
+        }
         cv.notify_all();
-        for (auto& t : threads) {
-            t.join();
+        for (auto& worker : workers) {
+            if (worker->thread.joinable())
+                worker->thread.join();
         }
     }
 
@@ -43,63 +422,581 @@ public:
         return pool;
     }
 
+    /**
+     * @brief Run function with arguments on the pool
+     *
+     * Shared state of the returned future comes from PoolAllocator and the
+     * task itself is stored inline, so small tasks do not touch the global
+     * allocator once the pool is warmed up.
+     */
     template <typename F, typename... Args>
     auto addTask(F&& fun, Args&&... args)
+        -> std::future<std::invoke_result_t<std::decay_t<F>&, std::decay_t<Args>&...>>
     {
-        using ReturnType = typename std::result_of<F(Args...)>::type;
-        Lock lock{mtx};
-        if (buffer.size() + 1 > threads.size()) {
-            threads.push_back(std::thread([this]() { run(); }));
+        return submit(TaskPriority::Normal, Clock::time_point{}, std::forward<F>(fun), std::forward<Args>(args)...);
+    }
+
+    /**
+     * @brief Run function with arguments as task of given priority class
+     */
+    template <typename F, typename... Args>
+    auto addTask(TaskPriority priority, F&& fun, Args&&... args)
+    {
+        return submit(priority, Clock::now(), std::forward<F>(fun), std::forward<Args>(args)...);
+    }
+
+    /**
+     * @brief Run function with arguments as High task due at deadline
+     *
+     * Deadline only orders High tasks, a task past its deadline still runs.
+     */
+    template <typename F, typename... Args>
+    auto addTask(Clock::time_point deadline, F&& fun, Args&&... args)
+    {
+        return submit(TaskPriority::High, deadline, std::forward<F>(fun), std::forward<Args>(args)...);
+    }
+
+    /**
+     * @brief Run function with arguments on the pool without any result
+     *
+     * Cheapest way of submitting work, there is no shared state at all.
+     * The function must not throw, an escaping exception terminates the
+     * program like it would on a plain std::thread.
+     */
+    template <typename F, typename... Args>
+    auto post(F&& fun, Args&&... args)
+        -> std::enable_if_t<std::is_invocable<std::decay_t<F>&, std::decay_t<Args>&...>::value>
+    {
+        push(TaskPriority::Normal, Clock::time_point{}, bindTask(std::forward<F>(fun), std::forward<Args>(args)...));
+    }
+
+    template <typename F, typename... Args>
+    void post(TaskPriority priority, F&& fun, Args&&... args)
+    {
+        push(priority, Clock::now(), bindTask(std::forward<F>(fun), std::forward<Args>(args)...));
+    }
+
+    template <typename F, typename... Args>
+    void post(Clock::time_point deadline, F&& fun, Args&&... args)
+    {
+        push(TaskPriority::High, deadline, bindTask(std::forward<F>(fun), std::forward<Args>(args)...));
+    }
+
+#ifdef __cpp_impl_coroutine
+    /**
+     * @brief Awaitable which resumes the awaiting coroutine on a worker of this pool
+     */
+    auto schedule(TaskPriority priority = TaskPriority::Normal)
+    {
+        struct Awaiter {
+            ThreadPool& pool;
+            TaskPriority priority;
+
+            bool await_ready() const noexcept
+            {
+                return false;
+            }
+
+            void await_suspend(std::coroutine_handle<> handle)
+            {
+                pool.post(priority, [handle]() { handle.resume(); });
+            }
+
+            void await_resume() const noexcept
+            {
+            }
+        };
+        return Awaiter{*this, priority};
+    }
+#endif
+
+    /**
+     * @brief Number of currently running workers
+     */
+    size_t size() const
+    {
+        return threadCount;
+    }
+
+    /**
+     * @brief Maximal number of workers
+     */
+    size_t capacity() const
+    {
+        return workers.size();
+    }
+
+    /**
+     * @brief Current counters and latency histograms
+     *
+     * Everything except queue depth stays zero unless the pool was created
+     * with instrumentation enabled. Safe to call while the pool runs.
+     */
+    ThreadPoolStats stats() const
+    {
+        ThreadPoolStats result;
+        result.elapsed = Clock::now() - created;
+        for (size_t c = 0; c < depth.size(); ++c) {
+            result.queueDepth[c] = depth[c];
         }
-        auto task = std::make_shared<std::packaged_task<ReturnType()>>(
-            std::bind(std::forward<F>(fun), std::forward<Args>(args)...));
-        std::future<ReturnType> f = task->get_future();
-        buffer.push([task]() { (*task)(); });
-        cv.notify_all();
-        return f;
+        for (auto& worker : workers) {
+            ThreadPoolStats::Worker entry;
+            if (worker->counters) {
+                auto& counters = *worker->counters;
+                entry.tasks = counters.tasks.load(std::memory_order_relaxed);
+                entry.steals = counters.steals.load(std::memory_order_relaxed);
+                entry.busy = std::chrono::nanoseconds{counters.busyNanoseconds.load(std::memory_order_relaxed)};
+                counters.queueTime.addTo(result.queueTime);
+                counters.runTime.addTo(result.runTime);
+            }
+            result.workers.push_back(entry);
+        }
+        return result;
+    }
+
+    /**
+     * @brief Number of tasks of given priority waiting for a worker
+     */
+    size_t queueDepth(TaskPriority priority) const
+    {
+        return depth[static_cast<size_t>(priority)];
     }
 
 private:
-    void createThreads(size_t size)
+    static ThreadPoolOptions fixedSize(size_t size, Scheduling scheduling)
+    {
+        ThreadPoolOptions options;
+        options.minThreads = options.maxThreads = size;
+        options.scheduling = scheduling;
+        return options;
+    }
+
+    template <typename F, typename... Args>
+    auto submit(TaskPriority priority, Clock::time_point deadline, F&& fun, Args&&... args)
+    {
+        using ReturnType = std::invoke_result_t<std::decay_t<F>&, std::decay_t<Args>&...>;
+        std::promise<ReturnType> promise{std::allocator_arg, PoolAllocator<char>{}};
+        std::future<ReturnType> f = promise.get_future();
+
+        push(priority, deadline,
+             [promise = std::move(promise), fun = std::forward<F>(fun),
+              arguments = std::make_tuple(std::forward<Args>(args)...)]() mutable {
+                 try {
+                     if constexpr (std::is_void<ReturnType>::value) {
+                         std::apply(fun, arguments);
+                         promise.set_value();
+                     }
+                     else {
+                         promise.set_value(std::apply(fun, arguments));
+                     }
+                 }
+                 catch (...) {
+                     promise.set_exception(std::current_exception());
+                 }
+             });
+        return f;
+    }
+
+    template <typename F, typename... Args>
+    static TaskFunction bindTask(F&& fun, Args&&... args)
+    {
+        if constexpr (sizeof...(Args) == 0) {
+            return TaskFunction{std::forward<F>(fun)};
+        }
+        else {
+            return TaskFunction{[fun = std::forward<F>(fun),
+                               arguments = std::make_tuple(std::forward<Args>(args)...)]() mutable {
+                std::apply(fun, arguments);
+            }};
+        }
+    }
+
+    void push(TaskPriority priority, Clock::time_point deadline, TaskFunction&& fun)
+    {
+        ThreadTask task{std::move(fun), instrumented ? Clock::now() : Clock::time_point{}};
+        if (scheduling == Scheduling::WorkStealing) {
+            pushStealable(priority, deadline, std::move(task));
+            return;
+        }
+
+        Lock lock{mtx};
+        buffer.push(priority, deadline, std::move(task));
+        ++depth[static_cast<size_t>(priority)];
+        wakeWorker(queuedTasks());
+    }
+
+    // wake one sleeper unless spinning workers will pick the queued tasks up anyway
+    void wakeWorker(size_t queued)
+    {
+        size_t spinners = spinning.load();
+        if (sleeping.load() > 0) {
+            if (queued > spinners)
+                cv.notify_one();
+        }
+        else if (queued > spinners && threadCount < workers.size()) {
+            startWorker();
+        }
+    }
+
+    size_t queuedTasks() const
+    {
+        return depth[0] + depth[1] + depth[2];
+    }
+
+    static WorkerContext& currentWorker()
+    {
+        static thread_local WorkerContext context;
+        return context;
+    }
+
+    void createThreads(size_t maxThreads)
+    {
+        for (size_t i = 0; i < maxThreads; ++i) {
+            workers.push_back(std::make_unique<Worker>());
+            if (instrumented)
+                workers.back()->counters = std::make_unique<detail::WorkerCounters>();
+        }
+        assignNodes();
+
+        for (size_t i = 0; i < minThreads; ++i) {
+            startWorker();
+        }
+    }
+
+    // group pinned workers by NUMA node, unpinned ones all count as node 0
+    void assignNodes()
+    {
+        auto& topology = NumaTopology::instance();
+        if (!cpuOrder.empty()) {
+            nodeWorkers.resize(topology.nodeCount());
+            for (size_t i = 0; i < workers.size(); ++i) {
+                workers[i]->node = topology.nodeOf(cpuOrder[i % cpuOrder.size()]);
+                nodeWorkers[workers[i]->node].push_back(i);
+            }
+        }
+
+        for (size_t i = 0; i < workers.size(); ++i) {
+            auto& victims = workers[i]->victims;
+            for (size_t v = 1; v < workers.size(); ++v) {
+                victims.push_back((i + v) % workers.size());
+            }
+            std::stable_partition(victims.begin(), victims.end(),
+                                  [&](size_t v) { return workers[v]->node == workers[i]->node; });
+        }
+    }
+
+    void pin(size_t index)
     {
-        for (size_t i = 0; i < size; ++i) {
-            threads.push_back(std::thread([this]() { run(); }));
+        if (!cpuOrder.empty())
+            pinCurrentThread(cpuOrder[index % cpuOrder.size()]);
+    }
+
+    // start worker in the first free slot, returns false when all slots are taken
+    bool startWorker()
+    {
+        std::lock_guard<std::mutex> lock{workersMtx};
+        for (size_t i = 0; i < workers.size(); ++i) {
+            auto& worker = *workers[i];
+            if (worker.active)
+                continue;
+
+            // the previous owner of the slot has already left the pool, just reap it
+            if (worker.thread.joinable())
+                worker.thread.join();
+
+            worker.active = true;
+            ++threadCount;
+            if (scheduling == Scheduling::WorkStealing)
+                worker.thread = std::thread([this, i]() {
+                    pin(i);
+                    runStealing(i);
+                });
+            else
+                worker.thread = std::thread([this, i]() {
+                    pin(i);
+                    run(i);
+                });
+            return true;
         }
+        return false;
+    }
+
+    // look for work without blocking for a while, returns true when work showed up
+    template <typename Predicate>
+    bool spinForTask(Predicate hasWork)
+    {
+        if (idlePolicy == IdlePolicy::Park)
+            return false;
+
+        int checksPerRound = idlePolicy == IdlePolicy::Spin ? 64 : 1;
+        auto until = Clock::now() + spinDuration;
+        bool found = false;
+        ++spinning;
+        do {
+            for (int i = 0; i < checksPerRound && !found; ++i) {
+                found = hasWork();
+                detail::cpuRelax();
+            }
+            if (!found && idlePolicy == IdlePolicy::Yield)
+                std::this_thread::yield();
+        } while (!found && Clock::now() < until);
+        --spinning;
+        return found;
     }
 
-    void run()
+    // called by idle worker, returns true when the worker should exit
+    template <typename Predicate>
+    bool retireWorker(size_t index, Predicate hasWork)
     {
+        std::lock_guard<std::mutex> lock{workersMtx};
+        if (threadCount <= minThreads)
+            return false;
+
+        // decrement first and then look for work, submitters do it the other way round
+        --threadCount;
+        if (hasWork()) {
+            ++threadCount;
+            return false;
+        }
+        workers[index]->active = false;
+        return true;
+    }
+
+    // wait for work, returns false when the worker retired
+    template <typename Predicate>
+    bool waitForTask(Lock& lock, size_t index, Predicate hasWork)
+    {
+        while (true) {
+            ++sleeping;
+            bool woken = cv.wait_for(lock, idleTimeout, [&]() { return shouldRun == false || hasWork(); });
+            --sleeping;
+
+            if (woken)
+                return true;
+            if (retireWorker(index, hasWork))
+                return false;
+        }
+    }
+
+    std::array<bool, 3> availableClasses() const
+    {
+        return {{depth[0] > 0, depth[1] > 0, depth[2] > 0}};
+    }
+
+    void run(size_t index)
+    {
+        currentWorker() = WorkerContext{this, index};
+        detail::PriorityPicker picker{priorityWeights};
         ThreadTask task;
+        TaskPriority priority;
 
+        Lock lock{mtx};
         while (true) {
-            // wait for new task or end of waiting on condition variable
-            {
+            // if there is task in buffer execute it and continue to next task
+            if (picker.pick(availableClasses(), priority)) {
+                task = buffer.pop(priority);
+                --depth[static_cast<size_t>(priority)];
+                lock.unlock();
+                execute(index, task);
+                lock.lock();
+                continue;
+            }
+
+            if (shouldRun == false)
+                return;
+
+            if (idlePolicy != IdlePolicy::Park) {
+                lock.unlock();
+                bool found = spinForTask([&]() { return queuedTasks() > 0 || shouldRun == false; });
+                lock.lock();
+                if (found)
+                    continue;
+            }
+
+            // otherwise wait for new task, stop looping when worker retired
+            if (!waitForTask(lock, index, [&]() { return !buffer.empty(); }))
+                return;
+        }
+    }
+
+    void execute(size_t index, ThreadTask& task)
+    {
+        if (!instrumented) {
+            task.fun();
+            task.fun = nullptr;
+            return;
+        }
+
+        auto& counters = *workers[index]->counters;
+        auto start = Clock::now();
+        counters.queueTime.record(start - task.queued);
+        task.fun();
+        task.fun = nullptr;
+        std::chrono::nanoseconds busy = Clock::now() - start;
+        counters.runTime.record(busy);
+        ConcurrentHistogram::bump(counters.tasks, 1);
+        ConcurrentHistogram::bump(counters.busyNanoseconds, static_cast<uint64_t>(busy.count()));
+    }
+
+    void pushStealable(TaskPriority priority, Clock::time_point deadline, ThreadTask&& task)
+    {
+        // count the task before it becomes visible so that pending never underflows
+        pending.fetch_add(1);
+        ++depth[static_cast<size_t>(priority)];
+
+        if (priority == TaskPriority::Normal) {
+            // tasks added from our own worker stay local, the rest is spread round robin
+            // between workers on the submitter's NUMA node
+            auto& context = currentWorker();
+            size_t index = context.pool == this ? context.index : externalQueue();
+            std::lock_guard<std::mutex> lock{workers[index]->mtx};
+            workers[index]->tasks.push_back(std::move(task));
+        }
+        else {
+            // High and Low tasks are shared, their ordering is global
+            Lock lock{mtx};
+            buffer.push(priority, deadline, std::move(task));
+        }
+
+        // pending, spinning and sleeping are sequentially consistent, so either we
+        // see the sleeper here or the sleeper sees the new task in its wait predicate,
+        // a worker stops counting as spinning before it checks the predicate
+        size_t spinners = spinning.load();
+        size_t queued = pending.load();
+        if (sleeping.load() > 0) {
+            if (queued > spinners) {
                 Lock lock{mtx};
-                cv.wait(lock, [&]() { return shouldRun == false || !buffer.empty(); });
+                cv.notify_one();
+            }
+        }
+        else if (queued > spinners && threadCount < workers.size()) {
+            startWorker();
+        }
+    }
 
-                if (!buffer.empty()) {
-                    task = std::move(buffer.front());
-                    buffer.pop();
-                }
+    size_t externalQueue()
+    {
+        if (!nodeWorkers.empty()) {
+            auto& local = nodeWorkers[NumaTopology::instance().currentNode()];
+            if (!local.empty())
+                return local[nextQueue++ % local.size()];
+        }
+        return nextQueue++ % workers.size();
+    }
+
+    bool popLocal(size_t index, ThreadTask& task)
+    {
+        auto& worker = *workers[index];
+        std::lock_guard<std::mutex> lock{worker.mtx};
+        if (worker.tasks.empty())
+            return false;
+        task = worker.tasks.pop_back();
+        return true;
+    }
+
+    // deques of retired workers are scanned as well, nothing is left behind
+    bool steal(size_t index, ThreadTask& task)
+    {
+        for (auto victim : workers[index]->victims) {
+            auto& worker = *workers[victim];
+            std::lock_guard<std::mutex> lock{worker.mtx};
+            if (!worker.tasks.empty()) {
+                task = worker.tasks.pop_front();
+                if (instrumented)
+                    ConcurrentHistogram::bump(workers[index]->counters->steals, 1);
+                return true;
             }
+        }
+        return false;
+    }
+
+    bool takeStealing(size_t index, TaskPriority priority, ThreadTask& task)
+    {
+        if (depth[static_cast<size_t>(priority)] == 0)
+            return false;
 
-            // if there was task in buffer execute it and continue to next task
-            if (task != nullptr) {
-                task();
-                task = nullptr;
+        if (priority == TaskPriority::Normal) {
+            // newest local task first, oldest task of another worker otherwise
+            if (!popLocal(index, task) && !steal(index, task))
+                return false;
+        }
+        else {
+            Lock lock{mtx};
+            if (buffer.empty(priority))
+                return false;
+            task = buffer.pop(priority);
+        }
+        --depth[static_cast<size_t>(priority)];
+        return true;
+    }
+
+    bool takeStealing(size_t index, detail::PriorityPicker& picker, ThreadTask& task)
+    {
+        TaskPriority chosen;
+        if (!picker.pick(availableClasses(), chosen))
+            return false;
+        if (takeStealing(index, chosen, task))
+            return true;
+
+        // chosen class was drained by someone else in the meantime
+        for (auto priority : {TaskPriority::High, TaskPriority::Normal, TaskPriority::Low}) {
+            if (priority != chosen && takeStealing(index, priority, task))
+                return true;
+        }
+        return false;
+    }
+
+    void runStealing(size_t index)
+    {
+        currentWorker() = WorkerContext{this, index};
+        detail::PriorityPicker picker{priorityWeights};
+        ThreadTask task;
+
+        while (true) {
+            if (takeStealing(index, picker, task)) {
+                pending.fetch_sub(1);
+                execute(index, task);
                 continue;
             }
 
-            // otherwise stop looping
-            return;
+            if (spinForTask([&]() { return pending.load() > 0 || shouldRun == false; }) && pending.load() > 0)
+                continue;
+
+            // drain everything that was queued before stopping
+            Lock lock{mtx};
+            if (shouldRun == false && pending.load() == 0)
+                return;
+            if (!waitForTask(lock, index, [&]() { return pending.load() > 0; }))
+                return;
         }
     }
 
     std::atomic_bool shouldRun;
-    std::vector<std::thread> threads;
+    Scheduling scheduling;
+    size_t minThreads;
+    std::chrono::milliseconds idleTimeout;
+    std::array<unsigned, 3> priorityWeights;
+    bool instrumented;
+    IdlePolicy idlePolicy;
+    std::chrono::microseconds spinDuration;
+    Clock::time_point created;
+    // CPU of worker slot i is cpuOrder[i % size], empty when workers are not pinned
+    std::vector<unsigned> cpuOrder;
+    // worker slots by NUMA node, empty when workers are not pinned
+    std::vector<std::vector<size_t>> nodeWorkers;
     std::condition_variable cv;
     std::mutex mtx;
-    TaskBuffer buffer;
+    // shared queue, in WorkStealing mode only High and Low tasks go there
+    detail::PriorityQueues<ThreadTask> buffer;
+
+    std::mutex workersMtx;
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::atomic_size_t threadCount{0};
+    std::atomic_size_t nextQueue{0};
+    std::atomic_size_t pending{0};
+    std::atomic_size_t sleeping{0};
+    std::atomic_size_t spinning{0};
+    std::array<std::atomic_size_t, 3> depth{};
 };
 } // namespace Simple
 
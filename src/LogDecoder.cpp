@@ -0,0 +1,28 @@
+#include <Simple/BinaryLogger.hpp>
+
+#include <exception>
+#include <iostream>
+
+// prints files written by Simple::BinaryLogger as the text lines Simple::Logger writes
+int main(int argc, char* argv[])
+{
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <binary log file>..." << std::endl;
+        return 1;
+    }
+
+    try {
+        Simple::LogBuffer line;
+        for (int i = 1; i < argc; ++i) {
+            Simple::BinaryLogReader reader{argv[i]};
+            while (reader.next(line)) {
+                std::cout.write(line.data(), static_cast<std::streamsize>(line.size())).put('\n');
+            }
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -61,7 +61,15 @@ void Server::Listener::onAccept(boost::system::error_code ec)
 }
 
 Server::Server(const std::string& address, unsigned short port, int threads)
+    : Server(address, port, threads, Placement::None)
+{
+}
+
+Server::Server(const std::string& address, unsigned short port, int threads, Placement placement,
+               const std::vector<unsigned>& cpus)
     : threads_{threads == 0 ? std::thread::hardware_concurrency() : threads}
+    , cpuOrder_{placement == Placement::None ? std::vector<unsigned>{}
+                                             : NumaTopology::instance().placementOrder(placement, cpus)}
     , ioc_{threads}
     , listener_{ioc_, tcp::endpoint{boost::asio::ip::address::from_string(address), port}}
 {
@@ -82,12 +90,18 @@ void Server::start()
     };
     signals.async_wait(sigHandler);
 
+    // thread i runs on cpuOrder_[i % size], the calling thread only waits and keeps its own affinity
+    auto runPinned = [this](size_t i) {
+        if (!cpuOrder_.empty())
+            pinCurrentThread(cpuOrder_[i % cpuOrder_.size()]);
+        ioc_.run();
+    };
+
     std::vector<std::thread> ths;
-    ths.reserve(threads_ - 1);
-    for (auto i = threads_ - 1; i > 0; --i) {
-        ths.emplace_back([&]() { ioc_.run(); });
+    ths.reserve(threads_);
+    for (size_t i = 0; i < threads_; ++i) {
+        ths.emplace_back(runPinned, i);
     }
-    ioc_.run();
     for (auto& t : ths) {
         t.join();
     }
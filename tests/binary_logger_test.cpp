@@ -0,0 +1,175 @@
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Simple/BinaryLogger.hpp"
+
+namespace {
+
+std::string text(const Simple::LogBuffer& line)
+{
+    return std::string(line.data(), line.size());
+}
+
+// the part behind the time prefix
+std::string message(const std::string& line)
+{
+    return line.substr(23);
+}
+
+// without a file the lines are formatted right away and written by Logger
+void testWithoutFile(const Simple::fs::path& dir)
+{
+    LOG_TO_FILE(dir.string(), "text");
+    LOG_BINARY_INFO("not opened {} {}", 5, "yet");
+
+    std::vector<std::string> lines;
+    for (auto& entry : Simple::fs::directory_iterator(dir)) {
+        std::ifstream file{entry.path().string()};
+        std::string line;
+        while (std::getline(file, line)) {
+            lines.push_back(line);
+        }
+    }
+    assert(lines.size() == 1);
+    assert(message(lines[0]) == "    INFO: not opened 5 yet");
+}
+
+void testTypes(const Simple::fs::path& path)
+{
+    Simple::BinaryLogger::getInstance()->open(path.string());
+    std::string name = "name";
+    std::string longText(2 * Simple::detail::MaxBinaryString, 'a');
+    LOG_BINARY_INFO("no arguments");
+    LOG_BINARY_DEBUG("{} {} {} {} {}", -7, std::numeric_limits<uint64_t>::max(), static_cast<short>(-3),
+                     static_cast<unsigned char>(200), std::numeric_limits<int64_t>::min());
+    LOG_BINARY_TRACE("{} {} {} {}", 0.25, 1.5f, 1e6, 0.1 + 0.2);
+    LOG_BINARY_INFO("{}{}{} {} {}", true, false, 'x', name, "literal");
+    LOG_BINARY_INFO("{}", longText);
+    LOG_BINARY_INFO("more arguments than placeholders {}", 1, 2);
+    Simple::BinaryLogger::getInstance()->close();
+
+    Simple::BinaryLogReader reader{path.string()};
+    Simple::LogBuffer line;
+    std::vector<std::string> lines;
+    while (reader.next(line)) {
+        lines.push_back(text(line));
+    }
+    assert(lines.size() == 6);
+    assert(message(lines[0]) == "    INFO: no arguments");
+    assert(message(lines[1]) == "   DEBUG: -7 18446744073709551615 -3 200 -9223372036854775808");
+    assert(message(lines[2]) == "   TRACE: 0.25 1.5 1e+06 0.3");
+    assert(message(lines[3]) == "    INFO: 10x name literal");
+    assert(message(lines[4]) == "    INFO: " + longText.substr(0, Simple::detail::MaxBinaryString));
+    assert(message(lines[5]) == "    INFO: more arguments than placeholders 1 2");
+    // and the one logged before the file was opened
+    assert(reader.logSites().size() == 7);
+}
+
+// every record of every thread arrives, in the order the thread logged them,
+// also when the rings run full and wrap around
+void testThreads(const Simple::fs::path& path)
+{
+    // decoded times lie in between, prefixes compare like the times they show
+    char time[32];
+    std::string before(time, Simple::detail::formatTimestamp(time, Simple::detail::wallClockNanoseconds()));
+    Simple::BinaryLogger::getInstance()->open(path.string());
+
+    const int threadCount = 4;
+    const int lineCount = 50000;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < threadCount; ++t) {
+        threads.push_back(std::thread([t]() {
+            for (int i = 0; i < lineCount; ++i) {
+                LOG_BINARY_TRACE("thread {} line {} padding {}", t, i, "0123456789");
+            }
+        }));
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    Simple::BinaryLogger::getInstance()->flush();
+    Simple::BinaryLogger::getInstance()->close();
+    std::string after(time, Simple::detail::formatTimestamp(time, Simple::detail::wallClockNanoseconds()));
+
+    Simple::BinaryLogReader reader{path.string()};
+    Simple::LogBuffer line;
+    std::vector<int> next(threadCount, 0);
+    int total = 0;
+    while (reader.next(line)) {
+        auto content = text(line);
+        assert(content.substr(0, before.size()) >= before && content.substr(0, after.size()) <= after);
+        auto position = content.find("thread ");
+        assert(position != std::string::npos);
+        int t = 0;
+        int i = 0;
+        assert(sscanf(content.c_str() + position, "thread %d line %d", &t, &i) == 2);
+        assert(next[t] == i);
+        ++next[t];
+        ++total;
+    }
+    assert(total == threadCount * lineCount);
+}
+
+// threads waiting for room in a full ring go on without the file when it is closed
+void testCloseWhileFull(const Simple::fs::path& dir)
+{
+    LOG_TO_FILE(dir.string(), "closed");
+    Simple::BinaryLogger::getInstance()->open((dir / "closed.slog").string());
+
+    const int threadCount = 4;
+    const int linesAfterClose = 10;
+    std::atomic_bool closed{false};
+    std::string padding(200, 'x');
+    std::vector<std::thread> threads;
+    for (int t = 0; t < threadCount; ++t) {
+        threads.push_back(std::thread([&]() {
+            int left = linesAfterClose;
+            while (!closed || left-- > 0) {
+                LOG_BINARY_TRACE("padding {}", padding);
+            }
+        }));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    Simple::BinaryLogger::getInstance()->close();
+    closed = true;
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    int lines = 0;
+    for (auto& entry : Simple::fs::directory_iterator(dir)) {
+        if (entry.path().extension() != ".log")
+            continue;
+        std::ifstream file{entry.path().string()};
+        std::string line;
+        while (std::getline(file, line)) {
+            assert(message(line) == "   TRACE: padding " + padding);
+            ++lines;
+        }
+    }
+    assert(lines >= threadCount * linesAfterClose);
+}
+} // namespace
+
+int main()
+{
+    LOG_REPORTING_LEVEL("Trace");
+    auto dir = Simple::fs::temp_directory_path() / "simple_binary_logger_test";
+    Simple::fs::remove_all(dir);
+
+    testWithoutFile(dir);
+    testTypes(dir / "types.slog");
+    testThreads(dir / "threads.slog");
+    testCloseWhileFull(dir / "closed");
+
+    Simple::fs::remove_all(dir);
+    return 0;
+}
@@ -0,0 +1,166 @@
+#include <atomic>
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iterator>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Simple/ConditionBuffer.hpp"
+
+namespace {
+
+using ClockType = std::chrono::steady_clock;
+
+const size_t MessageCount = 2000000;
+const size_t BufferSize = 1024;
+
+struct Message {
+    size_t sequence;
+    size_t payload;
+};
+
+// one producer hands messages over to one consumer, producer retries while buffer is full
+template <typename Buffer>
+double handOff()
+{
+    auto buffer = std::make_unique<Buffer>();
+    auto begin = ClockType::now();
+
+    std::thread producer([&]() {
+        for (size_t i = 0; i < MessageCount; ++i) {
+            while (!buffer->put(Message{i, i * 2})) {
+                std::this_thread::yield();
+            }
+        }
+        buffer->disable();
+    });
+
+    Message message;
+    size_t received = 0;
+    while (buffer->get(message)) {
+        ++received;
+    }
+    producer.join();
+
+    std::chrono::duration<double> elapsed = ClockType::now() - begin;
+    if (received != MessageCount)
+        std::cerr << "Lost messages: " << MessageCount - received << std::endl;
+    return MessageCount / elapsed.count();
+}
+
+// same hand-off moving Batch messages per call on both sides
+template <typename Buffer>
+double handOffBulk()
+{
+    const size_t Batch = 64;
+    auto buffer = std::make_unique<Buffer>();
+    auto begin = ClockType::now();
+
+    std::thread producer([&]() {
+        std::vector<Message> batch;
+        for (size_t i = 0; i < MessageCount; i += Batch) {
+            batch.clear();
+            for (size_t j = i; j < std::min(i + Batch, MessageCount); ++j) {
+                batch.push_back(Message{j, j * 2});
+            }
+            auto next = batch.begin();
+            while ((next += buffer->putBulk(next, batch.end())) != batch.end()) {
+                std::this_thread::yield();
+            }
+        }
+        buffer->disable();
+    });
+
+    std::vector<Message> messages;
+    messages.reserve(Batch);
+    size_t received = 0;
+    while (size_t count = buffer->getBulk(std::back_inserter(messages), Batch)) {
+        received += count;
+        messages.clear();
+    }
+    producer.join();
+
+    std::chrono::duration<double> elapsed = ClockType::now() - begin;
+    if (received != MessageCount)
+        std::cerr << "Lost messages: " << MessageCount - received << std::endl;
+    return MessageCount / elapsed.count();
+}
+
+// producers and consumers share one buffer, consumers count what they get
+template <typename Buffer>
+double share(size_t producers, size_t consumers)
+{
+    auto buffer = std::make_unique<Buffer>();
+    std::atomic_size_t received{0};
+    auto begin = ClockType::now();
+
+    std::vector<std::thread> threads;
+    for (size_t c = 0; c < consumers; ++c) {
+        threads.push_back(std::thread([&]() {
+            Message message;
+            size_t count = 0;
+            while (buffer->get(message)) {
+                ++count;
+            }
+            received += count;
+        }));
+    }
+
+    std::vector<std::thread> senders;
+    for (size_t p = 0; p < producers; ++p) {
+        senders.push_back(std::thread([&, p]() {
+            for (size_t i = p; i < MessageCount; i += producers) {
+                while (!buffer->put(Message{i, i * 2})) {
+                    std::this_thread::yield();
+                }
+            }
+        }));
+    }
+
+    for (auto& s : senders)
+        s.join();
+    buffer->disable();
+    for (auto& t : threads)
+        t.join();
+
+    std::chrono::duration<double> elapsed = ClockType::now() - begin;
+    if (received != MessageCount)
+        std::cerr << "Lost messages: " << MessageCount - received << std::endl;
+    return MessageCount / elapsed.count();
+}
+
+void report(const std::string& name, double messagesPerSecond)
+{
+    std::cout << std::setw(10) << name << std::setw(16) << static_cast<size_t>(messagesPerSecond) << std::endl;
+}
+} // namespace
+
+int main()
+{
+    std::cout << "Single producer, single consumer (" << MessageCount << " messages, buffer of " << BufferSize
+              << ")" << std::endl;
+    std::cout << std::setw(10) << "policy" << std::setw(16) << "messages/s" << std::endl;
+    report("locked", handOff<Simple::ConditionBuffer<Message, BufferSize>>());
+    report("spsc", handOff<Simple::ConditionBuffer<Message, BufferSize, Simple::BufferPolicy::Spsc>>());
+    report("mpmc", handOff<Simple::ConditionBuffer<Message, BufferSize, Simple::BufferPolicy::Mpmc>>());
+
+    std::cout << std::endl
+              << "Same in batches of 64" << std::endl;
+    std::cout << std::setw(10) << "policy" << std::setw(16) << "messages/s" << std::endl;
+    report("locked", handOffBulk<Simple::ConditionBuffer<Message, BufferSize>>());
+    report("spsc", handOffBulk<Simple::ConditionBuffer<Message, BufferSize, Simple::BufferPolicy::Spsc>>());
+    report("mpmc", handOffBulk<Simple::ConditionBuffer<Message, BufferSize, Simple::BufferPolicy::Mpmc>>());
+
+    for (size_t threads : {2, 4}) {
+        std::cout << std::endl
+                  << threads << " producers, " << threads << " consumers" << std::endl;
+        std::cout << std::setw(10) << "policy" << std::setw(16) << "messages/s" << std::endl;
+        report("locked", share<Simple::ConditionBuffer<Message, BufferSize>>(threads, threads));
+        report("mpmc", share<Simple::ConditionBuffer<Message, BufferSize, Simple::BufferPolicy::Mpmc>>(threads, threads));
+    }
+    return 0;
+}
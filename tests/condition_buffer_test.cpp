@@ -1,5 +1,11 @@
+#include <atomic>
+#include <chrono>
+#include <cassert>
 #include <iostream>
+#include <iterator>
+#include <string>
 #include <thread>
+#include <vector>
 
 #include "Simple/ConditionBuffer.hpp"
 #include "Simple/Logger.hpp"
@@ -34,6 +40,106 @@ void logFullBuffer()
     LOG_INFO << "Buffer is full";
 }
 
+// batches keep their order with one producer and one consumer
+template <typename Buffer>
+void testBulk(const char* name)
+{
+    Buffer buffer;
+    std::vector<MyObject> input;
+    for (int i = 0; i < 10; ++i) {
+        input.push_back({i, -i});
+    }
+    assert(buffer.putBulk(input.begin(), input.end()) == 8);
+
+    std::vector<MyObject> output;
+    assert(buffer.getBulk(std::back_inserter(output), 3) == 3);
+    assert(buffer.drain(std::back_inserter(output)) == 5);
+    assert(buffer.drain(std::back_inserter(output)) == 0);
+    for (int i = 0; i < 8; ++i) {
+        assert(output[i].x == i);
+    }
+
+    const int count = 100000;
+    std::thread producer([&]() {
+        std::vector<MyObject> batch;
+        for (int i = 0; i < count; i += 50) {
+            batch.clear();
+            for (int j = i; j < i + 50; ++j) {
+                batch.push_back({j, -j});
+            }
+            auto next = batch.begin();
+            while (next != batch.end()) {
+                next += buffer.putBulk(next, batch.end());
+                std::this_thread::yield();
+            }
+        }
+        buffer.disable();
+    });
+
+    int expected = 0;
+    output.clear();
+    while (buffer.getBulk(std::back_inserter(output), 64) > 0) {
+        for (auto& object : output) {
+            assert(object.x == expected && object.y == -expected);
+            ++expected;
+        }
+        output.clear();
+    }
+    producer.join();
+    assert(expected == count);
+    LOG_INFO << name << " delivered " << expected << " elements in batches";
+}
+
+// full buffer makes producers wait, timeouts give up without losing the element
+template <typename Buffer>
+void testBackpressure(const char* name)
+{
+    using namespace std::chrono_literals;
+
+    Buffer buffer;
+    std::string element;
+    auto begin = std::chrono::steady_clock::now();
+    assert(!buffer.tryGetFor(element, 20ms));
+    assert(std::chrono::steady_clock::now() - begin >= 20ms);
+
+    const std::string copied = "copied";
+    assert(buffer.put(copied));
+    assert(buffer.emplace(3, 'x'));
+    std::string moved = "moved";
+    assert(buffer.put(std::move(moved)));
+    assert(buffer.putWait(std::string("waited")));
+
+    std::string rejected = "rejected";
+    assert(!buffer.put(copied));
+    assert(!buffer.tryPutFor(std::move(rejected), 20ms));
+    assert(rejected == "rejected");
+
+    for (auto expected : {"copied", "xxx", "moved", "waited"}) {
+        assert(buffer.tryGetFor(element, 20ms) && element == expected);
+    }
+
+    const int count = 20000;
+    std::thread producer([&]() {
+        for (int i = 0; i < count; ++i) {
+            assert(buffer.putWait(std::to_string(i)));
+        }
+    });
+    for (int i = 0; i < count; ++i) {
+        assert(buffer.get(element) && element == std::to_string(i));
+    }
+    producer.join();
+
+    // disabling releases a producer blocked on a full buffer
+    for (int i = 0; i < 4; ++i) {
+        assert(buffer.put(std::to_string(i)));
+    }
+    std::thread blocked([&]() { assert(!buffer.putWait(std::string("late"))); });
+    std::this_thread::sleep_for(20ms);
+    buffer.disable();
+    blocked.join();
+    LOG_INFO << name << " applied backpressure";
+}
+
 int main()
 {
     Simple::ConditionBuffer<MyObject, 1000> buffer;
@@ -61,4 +167,109 @@ int main()
 
     for (auto& c : consumers)
         c.join();
+
+    Simple::ConditionBuffer<MyObject, 100, Simple::BufferPolicy::Spsc> ring;
+    std::thread ringProducer([&]() {
+        for (int i = 0; i < 100000; ++i) {
+            while (!ring.put({i, -i})) {
+                std::this_thread::yield();
+            }
+        }
+        ring.disable();
+    });
+
+    // single consumer sees elements in order
+    MyObject object;
+    int expected = 0;
+    while (ring.get(object)) {
+        assert(object.x == expected && object.y == -expected);
+        ++expected;
+    }
+    ringProducer.join();
+    assert(expected == 100000);
+    LOG_INFO << "SPSC ring delivered " << expected << " elements in order";
+
+    // every element reaches exactly one of many consumers
+    Simple::ConditionBuffer<MyObject, 100, Simple::BufferPolicy::Mpmc> queue;
+    const int producerCount = 4;
+    const int perProducer = 25000;
+    std::atomic<long long> sum{0};
+    std::atomic_int received{0};
+
+    std::vector<std::thread> queueConsumers;
+    for (int i = 0; i < 4; ++i) {
+        queueConsumers.push_back(std::thread([&]() {
+            MyObject element;
+            while (queue.get(element)) {
+                assert(element.y == -element.x);
+                sum += element.x;
+                ++received;
+            }
+        }));
+    }
+
+    std::vector<std::thread> queueProducers;
+    for (int p = 0; p < producerCount; ++p) {
+        queueProducers.push_back(std::thread([&, p]() {
+            for (int i = 0; i < perProducer; ++i) {
+                int x = p * perProducer + i;
+                while (!queue.put({x, -x})) {
+                    std::this_thread::yield();
+                }
+            }
+        }));
+    }
+
+    for (auto& p : queueProducers)
+        p.join();
+    queue.disable();
+    for (auto& c : queueConsumers)
+        c.join();
+
+    const long long total = producerCount * perProducer;
+    assert(received == total);
+    assert(sum == total * (total - 1) / 2);
+    LOG_INFO << "MPMC queue delivered " << received << " elements to " << queueConsumers.size() << " consumers";
+
+    testBulk<Simple::ConditionBuffer<MyObject, 8>>("Locked buffer");
+    testBulk<Simple::ConditionBuffer<MyObject, 8, Simple::BufferPolicy::Spsc>>("SPSC ring");
+    testBulk<Simple::ConditionBuffer<MyObject, 8, Simple::BufferPolicy::Mpmc>>("MPMC queue");
+
+    testBackpressure<Simple::ConditionBuffer<std::string, 4>>("Locked buffer");
+    testBackpressure<Simple::ConditionBuffer<std::string, 4, Simple::BufferPolicy::Spsc>>("SPSC ring");
+    testBackpressure<Simple::ConditionBuffer<std::string, 4, Simple::BufferPolicy::Mpmc>>("MPMC queue");
+
+    // blocked producers of the locked buffer get their turn in arrival order
+    Simple::ConditionBuffer<std::string, 1> fair;
+    assert(fair.put(std::string("first")));
+    std::thread early([&]() { fair.putWait(std::string("early")); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    std::thread late([&]() { fair.putWait(std::string("late")); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    assert(!fair.put(std::string("barging")));
+    std::string taken;
+    for (auto expected : {"first", "early", "late"}) {
+        assert(fair.get(taken) && taken == expected);
+    }
+    early.join();
+    late.join();
+    LOG_INFO << "Locked buffer served blocked producers in order";
+
+    // peek reads queued elements in place, waitFor waits for one without taking it
+    Simple::ConditionBuffer<std::string, 4, Simple::BufferPolicy::Mpmc> peeked;
+    assert(!peeked.waitFor(std::chrono::milliseconds(1)));
+    std::thread putter([&]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        peeked.put(std::string("a"));
+    });
+    assert(peeked.waitFor(std::chrono::seconds(10)));
+    putter.join();
+    peeked.put(std::string(300, 'b'));
+    std::vector<std::string> seen;
+    assert(peeked.peek([&](const std::string& element) { seen.push_back(element); }) == 2);
+    assert((seen == std::vector<std::string>{"a", std::string(300, 'b')}));
+    assert(peeked.get(taken) && taken == "a");
+    assert(peeked.get(taken) && taken == std::string(300, 'b'));
+    peeked.disable();
+    assert(!peeked.waitFor(std::chrono::seconds(10)));
 }
@@ -0,0 +1,83 @@
+#include <atomic>
+#include <cassert>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "Simple/Coroutine.hpp"
+#include "Simple/Logger.hpp"
+
+Simple::Task<int> square(Simple::ThreadPool& pool, int value)
+{
+    co_await pool.schedule();
+    co_return value * value;
+}
+
+Simple::Task<int> sumOfSquares(Simple::ThreadPool& pool, int count)
+{
+    int sum = 0;
+    for (int i = 1; i <= count; ++i) {
+        sum += co_await square(pool, i);
+    }
+    co_return sum;
+}
+
+Simple::Task<void> fail(Simple::ThreadPool& pool)
+{
+    co_await pool.schedule();
+    throw std::runtime_error("coroutine failed");
+}
+
+Simple::Task<void> waitForSignal(Simple::Future<int> signal, std::atomic_int& total)
+{
+    total += co_await std::move(signal);
+}
+
+int main()
+{
+    Simple::ThreadPool pool(2);
+
+    auto mainThread = std::this_thread::get_id();
+    auto worker = Simple::syncWait([](Simple::ThreadPool& pool) -> Simple::Task<std::thread::id> {
+        co_await pool.schedule(Simple::TaskPriority::High);
+        co_return std::this_thread::get_id();
+    }(pool));
+    assert(worker != mainThread);
+
+    assert(Simple::syncWait(sumOfSquares(pool, 10)) == 385);
+
+    try {
+        Simple::syncWait(fail(pool));
+        assert(false);
+    }
+    catch (const std::runtime_error& ex) {
+        LOG_INFO << "Exception from coroutine: " << ex.what();
+    }
+
+    assert(Simple::syncWait([](Simple::ThreadPool& pool) -> Simple::Task<int> {
+        co_return co_await Simple::submit(pool, []() { return 42; });
+    }(pool)) == 42);
+
+    // suspended coroutines hold no thread, only their frames
+    const int waiting = 10000;
+    std::atomic_int total{0};
+    std::vector<Simple::Promise<int>> signals(waiting);
+    std::vector<Simple::Future<void>> started;
+    for (auto& signal : signals) {
+        started.push_back(Simple::spawn(pool, waitForSignal(signal.getFuture(&pool), total)));
+    }
+    assert(total == 0);
+    std::thread producer([&]() {
+        for (auto& signal : signals) {
+            signal.setValue(1);
+        }
+    });
+    for (auto& f : Simple::whenAll(std::move(started)).get()) {
+        f.get();
+    }
+    producer.join();
+    assert(total == waiting);
+    LOG_INFO << "Resumed coroutines: " << total << " on " << pool.size() << " workers";
+
+    return 0;
+}
@@ -0,0 +1,123 @@
+#include <atomic>
+#include <cassert>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Simple/Future.hpp"
+#include "Simple/Logger.hpp"
+#include "Simple/TaskGraph.hpp"
+
+int main()
+{
+    Simple::ThreadPool pool(4);
+
+    auto length = Simple::submit(pool, [](std::string text) { return text; }, std::string{"continuation"})
+                      .then([](std::string text) { return text.size(); })
+                      .then([](size_t size) { return size * 2; });
+    assert(length.get() == 24);
+
+    // future returned from continuation is chained, not nested
+    auto chained = Simple::submit(pool, []() { return 20; }).then([&pool](int value) {
+        return Simple::submit(pool, [value]() { return value + 1; });
+    });
+    assert(chained.get() == 21);
+
+    auto failed = Simple::submit(pool, []() -> int { throw std::runtime_error("stage failed"); })
+                      .then([](int value) { return value + 1; });
+    try {
+        failed.get();
+        assert(false);
+    }
+    catch (const std::runtime_error& ex) {
+        LOG_INFO << "Exception from continuation chain: " << ex.what();
+    }
+
+    std::vector<Simple::Future<int>> parts;
+    for (int i = 0; i < 10; ++i) {
+        parts.push_back(Simple::submit(pool, [i]() { return i; }));
+    }
+    auto sum = Simple::whenAll(std::move(parts)).then([](std::vector<Simple::Future<int>> ready) {
+        int total = 0;
+        for (auto& f : ready) {
+            total += f.get();
+        }
+        return total;
+    });
+    assert(sum.get() == 45);
+
+    Simple::Promise<int> never;
+    std::vector<Simple::Future<int>> candidates;
+    candidates.push_back(never.getFuture(&pool));
+    candidates.push_back(Simple::makeReadyFuture(7));
+    auto any = Simple::whenAny(std::move(candidates)).get();
+    assert(any.index == 1);
+    assert(any.futures[1].get() == 7);
+
+    {
+        Simple::Promise<void> broken;
+        auto orphan = broken.getFuture();
+        broken = Simple::Promise<void>{};
+        try {
+            orphan.get();
+            assert(false);
+        }
+        catch (const std::future_error& ex) {
+            assert(ex.code() == std::future_errc::broken_promise);
+        }
+    }
+
+    // long chain on a single worker, nothing waits inside the pool
+    Simple::ThreadPool single(1);
+    auto chain = Simple::submit(single, []() { return 0; });
+    for (int i = 0; i < 1000; ++i) {
+        chain = chain.then([](int value) { return value + 1; });
+    }
+    assert(chain.get() == 1000);
+
+    // diamond: a -> (b, c) -> d
+    std::atomic_int a{0}, b{0}, c{0}, d{0};
+    Simple::TaskGraph graph;
+    auto na = graph.add([&]() { a = 1; });
+    auto nb = graph.add([&]() { b = a + 1; });
+    auto nc = graph.add([&]() { c = a + 2; });
+    auto nd = graph.add([&]() { d = b + c; });
+    graph.addDependency(nb, na);
+    graph.addDependency(nc, na);
+    graph.addDependency(nd, nb);
+    graph.addDependency(nd, nc);
+    graph.run(single).get();
+    assert(d == 5);
+    graph.run(pool).get();
+    assert(d == 5);
+    LOG_INFO << "Task graph result: " << d;
+
+    Simple::TaskGraph failing;
+    std::atomic_bool skipped{true};
+    auto first = failing.add([]() { throw std::runtime_error("node failed"); });
+    auto second = failing.add([&]() { skipped = false; });
+    failing.addDependency(second, first);
+    try {
+        failing.run(pool).get();
+        assert(false);
+    }
+    catch (const std::runtime_error& ex) {
+        LOG_INFO << "Exception from task graph: " << ex.what();
+    }
+    assert(skipped);
+
+    Simple::TaskGraph cyclic;
+    auto x = cyclic.add([]() {});
+    auto y = cyclic.add([]() {});
+    cyclic.addDependency(x, y);
+    cyclic.addDependency(y, x);
+    try {
+        cyclic.run(pool);
+        assert(false);
+    }
+    catch (const std::logic_error& ex) {
+        LOG_INFO << "Rejected graph: " << ex.what();
+    }
+
+    return 0;
+}
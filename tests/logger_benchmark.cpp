@@ -0,0 +1,185 @@
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Simple/BinaryLogger.hpp"
+#include "Simple/LatencyHistogram.hpp"
+#include "Simple/Logger.hpp"
+#include "Simple/StructuredLogger.hpp"
+
+namespace {
+std::atomic<uint64_t> allocations{0};
+}
+
+void* operator new(std::size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* memory = std::malloc(size == 0 ? 1 : size))
+        return memory;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+
+namespace {
+
+using ClockType = std::chrono::steady_clock;
+
+const int ThreadCount = 4;
+const int LinesPerThread = 50000;
+const int FormatLines = 200000;
+
+// cost of building one line on a single thread, with the old ostringstream way as reference
+void measureFormatting()
+{
+    // the logger still writes to std::cerr, which drops everything without a stream buffer
+    auto* errorBuffer = std::cerr.rdbuf(nullptr);
+
+    std::cout << "single thread, " << FormatLines << " lines, output discarded" << std::endl;
+    std::cout << std::setw(10) << "format" << std::setw(12) << "ns/line" << std::setw(14) << "allocs/line"
+              << std::endl;
+
+    auto measure = [](const std::string& name, auto logLine) {
+        auto allocationsBefore = allocations.load();
+        auto begin = ClockType::now();
+        for (int i = 0; i < FormatLines; ++i) {
+            logLine(i);
+        }
+        std::chrono::duration<double, std::nano> elapsed = ClockType::now() - begin;
+        std::cout << std::setw(10) << name << std::setw(12) << std::fixed << std::setprecision(1)
+                  << elapsed.count() / FormatLines << std::setw(14) << std::setprecision(2)
+                  << static_cast<double>(allocations.load() - allocationsBefore) / FormatLines << std::endl;
+    };
+
+    measure("ostream", [](int i) {
+        std::ostringstream os;
+        os << Simple::NowTime();
+        os << " " << std::setw(9) << std::string("INFO") + ": ";
+        os << "request " << i << " served by thread " << 0 << " in " << 0.25 * i << " ms";
+        Simple::Logger::getInstance()->writeStream(os.str());
+    });
+    measure("LogLine", [](int i) {
+        LOG_INFO << "request " << i << " served by thread " << 0 << " in " << 0.25 * i << " ms";
+    });
+    {
+        // the context is serialized once, records copy it
+        Simple::LogContext context("service", "benchmark", "thread", 0);
+        measure("json", [](int i) {
+            LOG_RECORD(Simple::LogLevel::Info, "request served").field("request", i).field("ms", 0.25 * i);
+        });
+    }
+    // below the reporting level, and compiled out in release builds
+    measure("disabled", [](int i) {
+        LOG_TRACE << "request " << i << " served by thread " << 0 << " in " << 0.25 * i << " ms";
+    });
+    // an error storm, one line in a thousand goes out
+    measure("sampled", [](int i) {
+        LOG_EVERY_N(Simple::LogLevel::Error, 1000) << "request " << i << " failed on thread " << 0;
+    });
+    measure("module", [](int i) {
+        LOG_MODULE("requests", Simple::LogLevel::Debug) << "request " << i << " served by thread " << 0;
+    });
+
+    // the writer thread shares the time, the file is written while the loop runs
+    auto binaryLog = Simple::fs::temp_directory_path() / "simple_logger_benchmark.slog";
+    Simple::BinaryLogger::getInstance()->open(binaryLog.string());
+    measure("binary", [](int i) {
+        LOG_BINARY_INFO("request {} served by thread {} in {} ms", i, 0, 0.25 * i);
+    });
+    Simple::BinaryLogger::getInstance()->close();
+    Simple::fs::remove(binaryLog);
+
+    std::cerr.rdbuf(errorBuffer);
+    std::cerr.clear();
+}
+
+// time spent inside every LOG_INFO statement on the calling threads
+Simple::LatencyHistogram measureCalls()
+{
+    std::vector<Simple::LatencyHistogram> histograms(ThreadCount);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < ThreadCount; ++t) {
+        threads.push_back(std::thread([t, &histograms]() {
+            for (int i = 0; i < LinesPerThread; ++i) {
+                auto begin = ClockType::now();
+                LOG_INFO << "request " << i << " served by thread " << t << " in " << 0.25 * i << " ms";
+                histograms[t].record(ClockType::now() - begin);
+            }
+        }));
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    Simple::LatencyHistogram total;
+    for (auto& histogram : histograms) {
+        total.merge(histogram);
+    }
+    return total;
+}
+
+void report(const std::string& name, const Simple::LatencyHistogram& calls, std::chrono::duration<double> elapsed)
+{
+    std::cout << std::setw(8) << name << std::setw(10) << static_cast<uint64_t>(calls.mean()) << std::setw(10)
+              << calls.percentile(0.5) << std::setw(10) << calls.percentile(0.99) << std::setw(10)
+              << calls.percentile(0.999) << std::setw(12) << calls.max() << std::setw(14)
+              << static_cast<uint64_t>(calls.count() / elapsed.count()) << std::endl;
+}
+} // namespace
+
+int main()
+{
+    measureFormatting();
+    std::cout << std::endl;
+
+    auto dir = Simple::fs::temp_directory_path() / "simple_logger_benchmark";
+    LOG_TO_FILE(dir.string(), "benchmark");
+
+    std::cout << ThreadCount << " threads, " << LinesPerThread << " lines each, latency of the call in ns" << std::endl;
+    std::cout << std::setw(8) << "mode" << std::setw(10) << "mean" << std::setw(10) << "p50" << std::setw(10) << "p99"
+              << std::setw(10) << "p99.9" << std::setw(12) << "max" << std::setw(14) << "lines/s" << std::endl;
+
+    auto begin = ClockType::now();
+    auto calls = measureCalls();
+    report("sync", calls, ClockType::now() - begin);
+
+    // synchronous as well, appended with memcpy to a mapping of the file
+    Simple::Logger::getInstance()->setMappedFile(16 << 20);
+    begin = ClockType::now();
+    calls = measureCalls();
+    report("mapped", calls, ClockType::now() - begin);
+    Simple::Logger::getInstance()->setMappedFile(0);
+
+    Simple::Logger::getInstance()->startAsync();
+    begin = ClockType::now();
+    calls = measureCalls();
+    Simple::Logger::getInstance()->flush();
+    report("async", calls, ClockType::now() - begin);
+
+    Simple::Logger::getInstance()->stopAsync();
+
+    Simple::Logger::getInstance()->startBuffered();
+    begin = ClockType::now();
+    calls = measureCalls();
+    Simple::Logger::getInstance()->flush();
+    report("buffered", calls, ClockType::now() - begin);
+
+    Simple::Logger::getInstance()->stopBuffered();
+    Simple::fs::remove_all(dir);
+    return 0;
+}
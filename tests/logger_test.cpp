@@ -1,5 +1,575 @@
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cctype>
+#include <csignal>
+#include <cstdlib>
+#include <cstdint>
+#include <ctime>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
 #include "Simple/Logger.hpp"
 
+#ifndef WIN32
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+struct Point {
+    int x;
+    int y;
+};
+
+std::ostream& operator<<(std::ostream& os, const Point& point)
+{
+    return os << "(" << point.x << ", " << point.y << ")";
+}
+
+// the fast paths of LogLine print what an ostream prints
+void testFormatting()
+{
+    auto dir = Simple::fs::temp_directory_path() / "simple_logger_format_test";
+    Simple::fs::remove_all(dir);
+    LOG_TO_FILE(dir.string(), "format");
+
+    std::vector<std::string> expected;
+    auto expect = [&expected](const std::ostream& os) {
+        expected.push_back(static_cast<const std::ostringstream&>(os).str());
+    };
+
+    LOG_INFO << 0 << " " << -1 << " " << std::numeric_limits<int64_t>::min() << " "
+             << std::numeric_limits<uint64_t>::max() << " " << static_cast<short>(-7) << " " << 42u;
+    expect(std::ostringstream() << 0 << " " << -1 << " " << std::numeric_limits<int64_t>::min() << " "
+                                << std::numeric_limits<uint64_t>::max() << " " << static_cast<short>(-7) << " " << 42u);
+
+    LOG_INFO << 0.25 << " " << 1e6 << " " << -3.5e-7 << " " << 123456789.0 << " " << 1.5f << " " << 0.1 + 0.2;
+    expect(std::ostringstream() << 0.25 << " " << 1e6 << " " << -3.5e-7 << " " << 123456789.0 << " " << 1.5f << " "
+                                << 0.1 + 0.2);
+
+    std::string text = "string";
+    LOG_INFO << true << false << 'x' << text << "literal";
+    expect(std::ostringstream() << true << false << 'x' << text << "literal");
+
+    LOG_INFO << Point{1, 2} << " then " << 3;
+    expect(std::ostringstream() << Point{1, 2} << " then " << 3);
+
+    LOG_INFO << std::hex << 255 << " " << 16;
+    expect(std::ostringstream() << std::hex << 255 << " " << 16);
+
+    // past the inline buffer
+    std::string longText(3 * Simple::LogBuffer::InlineSize, 'a');
+    LOG_INFO << longText << 7;
+    expect(std::ostringstream() << longText << 7);
+
+    std::vector<std::string> lines;
+    for (auto& entry : Simple::fs::directory_iterator(dir)) {
+        std::ifstream file{entry.path().string()};
+        std::string line;
+        while (std::getline(file, line)) {
+            lines.push_back(line);
+        }
+    }
+    assert(lines.size() == expected.size());
+    for (size_t i = 0; i < lines.size(); ++i) {
+        auto position = lines[i].find(" INFO: ");
+        assert(position != std::string::npos);
+        assert(lines[i].substr(position + 7) == expected[i]);
+    }
+    Simple::fs::remove_all(dir);
+}
+
+// messages of the lines in the files of dir
+std::vector<std::string> readMessages(const Simple::fs::path& dir)
+{
+    std::vector<std::string> lines;
+    for (auto& entry : Simple::fs::directory_iterator(dir)) {
+        std::ifstream file{entry.path().string()};
+        std::string line;
+        while (std::getline(file, line)) {
+            lines.push_back(line.substr(line.find(": ") + 2));
+        }
+    }
+    return lines;
+}
+
+int evaluated = 0;
+
+int countEvaluation()
+{
+    return ++evaluated;
+}
+
+// modules follow their own level when one is set and the reporting level otherwise
+void testLevels()
+{
+    auto dir = Simple::fs::temp_directory_path() / "simple_logger_level_test";
+    Simple::fs::remove_all(dir);
+    LOG_TO_FILE(dir.string(), "levels");
+    LOG_REPORTING_LEVEL("Info");
+
+    auto logModules = []() {
+        LOG_MODULE("network", Simple::LogLevel::Debug) << "network debug";
+        LOG_MODULE("storage", Simple::LogLevel::Debug) << "storage debug";
+        LOG_MODULE("storage", Simple::LogLevel::Info) << "storage info";
+    };
+    logModules();
+    LOG_MODULE_LEVEL("network", "Debug");
+    LOG_MODULE_LEVEL("storage", "Error");
+    logModules();
+    LOG_REPORTING_LEVEL("Trace");
+    logModules();
+    Simple::Logger::getInstance()->resetModuleLevel("network");
+    Simple::Logger::getInstance()->resetModuleLevel("storage");
+    logModules();
+
+    // the reporting level is still assignable through reportingLevel()
+    Simple::Logger::getInstance()->reportingLevel() = Simple::LogLevel::Warning;
+    int level = Simple::Logger::getInstance()->reportingLevel();
+    assert(level == Simple::LogLevel::Warning && Simple::Logger::currentLevel() == level);
+    LOG_INFO << "hidden by the assigned level";
+
+    // disabled statements do not evaluate their arguments
+    LOG_REPORTING_LEVEL("Info");
+    LOG_DEBUG << countEvaluation();
+    assert(evaluated == 0);
+
+    // neither do the ones above the compile time level, whatever the reporting level is
+#undef SIMPLE_LOGGER_MAX_LEVEL
+#define SIMPLE_LOGGER_MAX_LEVEL Simple::LogLevel::Info
+    LOG_REPORTING_LEVEL("Trace");
+    LOG_DEBUG << countEvaluation();
+    LOG_INFO << "evaluated " << countEvaluation();
+    assert(evaluated == 1);
+#undef SIMPLE_LOGGER_MAX_LEVEL
+#define SIMPLE_LOGGER_MAX_LEVEL Simple::LogLevel::Trace
+
+    auto lines = readMessages(dir);
+    assert((lines == std::vector<std::string>{"storage info", "network debug", "network debug", "network debug",
+                                              "storage debug", "storage info", "evaluated 1"}));
+    Simple::fs::remove_all(dir);
+}
+
+// suppressed lines are counted and summed up before the next line which goes out
+void testRateLimits()
+{
+    auto dir = Simple::fs::temp_directory_path() / "simple_logger_rate_test";
+    Simple::fs::remove_all(dir);
+    LOG_TO_FILE(dir.string(), "rates");
+
+    for (int i = 0; i < 7; ++i) {
+        LOG_EVERY_N(Simple::LogLevel::Info, 3) << "every third " << i;
+    }
+    const int everyLine = __LINE__ - 2;
+    for (int i = 0; i < 5; ++i) {
+        LOG_FIRST_N(Simple::LogLevel::Info, 2) << "first " << i;
+    }
+    const int firstLine = __LINE__ - 2;
+    for (int i = 0; i < 5; ++i) {
+        LOG_EVERY_MS(Simple::LogLevel::Info, 3600 * 1000) << "hourly " << i;
+    }
+    const int hourlyLine = __LINE__ - 2;
+    Simple::Logger::getInstance()->reportSuppressed();
+    // nothing left to report
+    Simple::Logger::getInstance()->reportSuppressed();
+
+    auto summary = [](int lines, int line) {
+        return "Suppressed " + std::to_string(lines) + " lines of " + __FILE__ + ":" + std::to_string(line);
+    };
+    auto lines = readMessages(dir);
+    assert((lines == std::vector<std::string>{"every third 0", summary(2, everyLine), "every third 3",
+                                              summary(2, everyLine), "every third 6", "first 0", "first 1",
+                                              "hourly 0", summary(3, firstLine), summary(4, hourlyLine)}));
+    Simple::fs::remove_all(dir);
+
+    // the counts stay exact when threads hit the same statement
+    LOG_TO_FILE(dir.string(), "rates");
+    const int threadCount = 4;
+    const int callCount = 10000;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < threadCount; ++t) {
+        threads.push_back(std::thread([]() {
+            for (int i = 0; i < callCount; ++i) {
+                LOG_EVERY_N(Simple::LogLevel::Info, 100) << "sampled";
+            }
+        }));
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    Simple::Logger::getInstance()->reportSuppressed();
+
+    int written = 0;
+    int suppressed = 0;
+    for (auto& line : readMessages(dir)) {
+        if (line == "sampled")
+            ++written;
+        else
+            suppressed += std::stoi(line.substr(std::string("Suppressed ").size()));
+    }
+    assert(written == threadCount * callCount / 100);
+    assert(written + suppressed == threadCount * callCount);
+    Simple::fs::remove_all(dir);
+}
+
+#ifndef WIN32
+// the cached prefix shows the current second and the milliseconds follow it
+void testTimestamps()
+{
+    // std::time may read a coarser clock which lags the one of the prefix
+    auto now = []() { return std::chrono::system_clock::to_time_t(std::chrono::system_clock::now()); };
+    for (int i = 0; i < 1000; ++i) {
+        auto before = now();
+        char formatted[32];
+        auto length = Simple::formatNowTime(formatted);
+        if (now() != before)
+            continue;
+
+        tm local;
+        localtime_r(&before, &local);
+        char expected[32];
+        auto expectedLength = strftime(expected, sizeof(expected), "%F %H:%M:%S", &local);
+        assert(length == expectedLength + 4);
+        assert(std::string(formatted, expectedLength) == std::string(expected, expectedLength));
+        assert(formatted[expectedLength] == '.');
+        for (size_t digit = expectedLength + 1; digit < length; ++digit) {
+            assert(std::isdigit(static_cast<unsigned char>(formatted[digit])));
+        }
+    }
+}
+#endif
+
+#ifndef WIN32
+// the whole file with its content, zeros included
+std::string readFile(const Simple::fs::path& path)
+{
+    std::ifstream file{path.string(), std::ios::binary};
+    std::ostringstream content;
+    content << file.rdbuf();
+    return content.str();
+}
+
+// lines "text i" for i in [begin, end), and nothing else
+void checkNumberedLines(const std::string& content, const std::string& text, int begin, int end)
+{
+    std::istringstream lines{content};
+    std::string line;
+    int next = begin;
+    while (std::getline(lines, line)) {
+        assert(line.substr(line.find(" INFO: ") + 7) == text + " " + std::to_string(next));
+        ++next;
+    }
+    assert(next == end);
+}
+
+// lines are in the file while it is open, also when the process dies without closing it
+void testMappedFile()
+{
+    auto dir = Simple::fs::temp_directory_path() / "simple_logger_mapped_test";
+    Simple::fs::remove_all(dir);
+    const std::size_t chunk = 64 * 1024;
+    // more than a few chunks, the mapping moves along
+    const int lineCount = 5000;
+
+    // a child dies without unmapping the file
+    auto child = fork();
+    if (child == 0) {
+        LOG_TO_FILE(dir.string(), "mapped");
+        Simple::Logger::getInstance()->setMappedFile(chunk);
+        for (int i = 0; i < lineCount; ++i) {
+            LOG_INFO << "mapped " << i;
+        }
+        _exit(0);
+    }
+    int status = 0;
+    waitpid(child, &status, 0);
+    assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+    auto path = Simple::fs::directory_iterator(dir)->path();
+    auto content = readFile(path);
+    auto end = content.find('\0');
+    assert(end != std::string::npos);
+    assert(content.find_first_not_of('\0', end) == std::string::npos);
+    checkNumberedLines(content.substr(0, end), "mapped", 0, lineCount);
+
+    // the lines go on after the ones of the child
+    LOG_TO_FILE(dir.string(), "mapped");
+    Simple::Logger::getInstance()->setMappedFile(chunk);
+    for (int i = lineCount; i < 2 * lineCount; ++i) {
+        LOG_INFO << "mapped " << i;
+    }
+    content = readFile(path);
+    checkNumberedLines(content.substr(0, content.find('\0')), "mapped", 0, 2 * lineCount);
+
+    // closed, the file ends with the last line
+    Simple::Logger::getInstance()->setMappedFile(0);
+    content = readFile(path);
+    assert(content.find('\0') == std::string::npos);
+    checkNumberedLines(content, "mapped", 0, 2 * lineCount);
+
+    // a failed mapped open leaves nothing behind for the next plain one
+    Simple::LogFile file;
+    assert(!file.open((dir / "missing" / "mapped.log").string(), chunk));
+    assert(file.open((dir / "plain.log").string()));
+    file.write("plain\n", 6);
+    file.close();
+    assert(readFile(dir / "plain.log") == "plain\n");
+    Simple::fs::remove_all(dir);
+}
+#endif
+
+#ifdef SIMPLE_LOGGER_ASYNC
+#ifndef WIN32
+void onAbort(int)
+{
+    _exit(42);
+}
+
+// queued lines are written on a crash and the program's own handler still runs
+void testSignalFlush(const Simple::fs::path& dir)
+{
+    const int lineCount = 1000;
+    auto child = fork();
+    if (child == 0) {
+        struct sigaction action = {};
+        action.sa_handler = &onAbort;
+        sigemptyset(&action.sa_mask);
+        sigaction(SIGABRT, &action, nullptr);
+
+        LOG_TO_FILE(dir.string(), "signal");
+        Simple::AsyncLogOptions options;
+        options.flushOnSignal = true;
+        Simple::Logger::getInstance()->startAsync(options);
+        // termination is left to the program
+        struct sigaction terminate;
+        sigaction(SIGTERM, nullptr, &terminate);
+        if (terminate.sa_handler != SIG_DFL)
+            _exit(1);
+        for (int i = 0; i < lineCount; ++i) {
+            LOG_INFO << "signal " << i;
+        }
+        std::abort();
+    }
+    int status = 0;
+    waitpid(child, &status, 0);
+    assert(WIFEXITED(status) && WEXITSTATUS(status) == 42);
+
+    // lines are complete and none twice, the writer may add the batch it held after the handler
+    std::istringstream content{readFile(Simple::fs::directory_iterator(dir)->path())};
+    std::vector<bool> seen(lineCount, false);
+    std::string line;
+    int lines = 0;
+    while (std::getline(content, line)) {
+        auto number = std::stoi(line.substr(line.find(" INFO: signal ") + 14));
+        assert(number >= 0 && number < lineCount && !seen[number]);
+        seen[number] = true;
+        ++lines;
+    }
+    LOG_INFO << "Signal handler left " << lines << " of " << lineCount << " lines";
+    Simple::fs::remove_all(dir);
+}
+#endif
+
+// flush waits for the caller's own line, also while other threads keep the writer busy
+void testFlushUnderLoad(const Simple::fs::path& dir)
+{
+    auto path = Simple::fs::directory_iterator(dir)->path();
+    std::atomic_bool done{false};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 3; ++t) {
+        threads.push_back(std::thread([&done]() {
+            while (!done) {
+                LOG_INFO << "background";
+                std::this_thread::yield();
+            }
+        }));
+    }
+    for (int i = 0; i < 20; ++i) {
+        // the line lands behind everything in the file now, and before what is there once flush returned
+        auto before = Simple::fs::file_size(path);
+        LOG_INFO << "flushed " << i;
+        Simple::Logger::getInstance()->flush();
+        auto after = Simple::fs::file_size(path);
+
+        std::string written(static_cast<std::size_t>(after - before), '\0');
+        std::ifstream file{path.string()};
+        file.seekg(static_cast<std::streamoff>(before));
+        file.read(&written[0], static_cast<std::streamsize>(written.size()));
+        assert(written.find(" INFO: flushed " + std::to_string(i) + "\n") != std::string::npos);
+    }
+    done = true;
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+// lines of every thread arrive complete and in the order the thread logged them
+void testThreads(const Simple::fs::path& dir)
+{
+    const int threadCount = 4;
+    const int lineCount = 5000;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < threadCount; ++t) {
+        threads.push_back(std::thread([t]() {
+            for (int i = 0; i < lineCount; ++i) {
+                LOG_INFO << "thread " << t << " line " << i;
+            }
+        }));
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    Simple::Logger::getInstance()->flush();
+
+    std::vector<int> next(threadCount, 0);
+    int total = 0;
+    for (auto& entry : Simple::fs::directory_iterator(dir)) {
+        std::ifstream file{entry.path().string()};
+        std::string line;
+        while (std::getline(file, line)) {
+            auto position = line.find("thread ");
+            assert(position != std::string::npos);
+            int t = 0;
+            int i = 0;
+            assert(sscanf(line.c_str() + position, "thread %d line %d", &t, &i) == 2);
+            assert(next[t] == i);
+            ++next[t];
+            ++total;
+        }
+    }
+    assert(total == threadCount * lineCount);
+}
+
+// one flush merges the buffers of all threads by time
+void testBufferedOrder(const Simple::fs::path& dir)
+{
+    LOG_TO_FILE(dir.string(), "order");
+    Simple::BufferedLogOptions options;
+    options.flushInterval = std::chrono::hours(1);
+    options.flushBytes = 1 << 20;
+    Simple::Logger::getInstance()->startBuffered(options);
+
+    LOG_INFO << "first";
+    std::thread([]() { LOG_INFO << "second"; }).join();
+    LOG_INFO << "third";
+    Simple::Logger::getInstance()->flush();
+
+    std::vector<std::string> lines;
+    for (auto& entry : Simple::fs::directory_iterator(dir)) {
+        std::ifstream file{entry.path().string()};
+        std::string line;
+        while (std::getline(file, line)) {
+            lines.push_back(line.substr(line.find(" INFO: ") + 7));
+        }
+    }
+    assert((lines == std::vector<std::string>{"first", "second", "third"}));
+    Simple::Logger::getInstance()->stopBuffered();
+    Simple::fs::remove_all(dir);
+}
+
+// segment index of name_date[.N].log[.gz]
+std::size_t segmentIndex(const std::string& file)
+{
+    auto end = file.find(".log");
+    auto dot = file.rfind('.', end - 1);
+    return dot != std::string::npos ? std::stoul(file.substr(dot + 1, end - dot - 1)) : 0;
+}
+
+bool isCompressed(const std::string& file)
+{
+    return file.size() > 3 && file.compare(file.size() - 3, 3, ".gz") == 0;
+}
+
+// segments of the day follow each other without losing a line,
+// the background thread compresses closed ones and keeps only the newest
+void testRotation(const Simple::fs::path& dir)
+{
+    const std::uint64_t maxBytes = 4096;
+    LOG_TO_FILE(dir.string(), "rotation");
+    Simple::LogRotation rotation;
+    rotation.maxBytes = maxBytes;
+    rotation.compress = false;
+    Simple::Logger::getInstance()->setRotation(rotation);
+
+    const int lineCount = 2000;
+    for (int i = 0; i < lineCount; ++i) {
+        LOG_INFO << "rotated line " << i;
+    }
+
+    std::vector<Simple::fs::path> segments;
+    for (auto& entry : Simple::fs::directory_iterator(dir)) {
+        segments.push_back(entry.path());
+    }
+    std::sort(segments.begin(), segments.end(), [](const Simple::fs::path& a, const Simple::fs::path& b) {
+        return segmentIndex(a.filename().string()) < segmentIndex(b.filename().string());
+    });
+    assert(segments.size() > 10);
+    int next = 0;
+    for (size_t s = 0; s < segments.size(); ++s) {
+        assert(segmentIndex(segments[s].filename().string()) == s);
+        std::ifstream file{segments[s].string()};
+        std::string line;
+        std::uint64_t bytes = 0;
+        while (std::getline(file, line)) {
+            bytes += line.size() + 1;
+            assert(line.substr(line.find(" INFO: ") + 7) == "rotated line " + std::to_string(next));
+            ++next;
+        }
+        // the line crossing the limit is the last one of a segment
+        assert(s + 1 == segments.size() || (bytes >= maxBytes && bytes < maxBytes + 100));
+    }
+    assert(next == lineCount);
+
+    rotation.maxFiles = 2;
+#ifdef SIMPLE_LOGGER_ZLIB
+    rotation.compress = true;
+#endif
+    Simple::Logger::getInstance()->setRotation(rotation);
+    for (int i = 0; i < lineCount; ++i) {
+        LOG_INFO << "rotated line " << i;
+    }
+
+    // the current segment and maxFiles closed ones remain once the background thread caught up
+    size_t files = 0;
+    for (int attempt = 0; attempt < 500; ++attempt) {
+        files = 0;
+        size_t plain = 0;
+        for (auto& entry : Simple::fs::directory_iterator(dir)) {
+            ++files;
+            plain += isCompressed(entry.path().filename().string()) ? 0 : 1;
+        }
+#ifdef SIMPLE_LOGGER_ZLIB
+        bool compressing = plain > 1;
+#else
+        bool compressing = false;
+        (void)plain;
+#endif
+        if (files == rotation.maxFiles + 1 && !compressing)
+            break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    assert(files == rotation.maxFiles + 1);
+#ifdef SIMPLE_LOGGER_ZLIB
+    size_t compressed = 0;
+    for (auto& entry : Simple::fs::directory_iterator(dir)) {
+        compressed += isCompressed(entry.path().filename().string()) ? 1 : 0;
+    }
+    assert(compressed == rotation.maxFiles);
+#endif
+
+    Simple::Logger::getInstance()->setRotation(Simple::LogRotation());
+    Simple::fs::remove_all(dir);
+}
+#endif
+} // namespace
+
 int main()
 {
     LOG_REPORTING_LEVEL("Trace");
@@ -8,5 +578,45 @@ int main()
     LOG_ERROR << "Error log line";
     LOG_DEBUG << "Debug log line";
     LOG_TRACE << "Trace log line";
+
+    testFormatting();
+    testLevels();
+    LOG_REPORTING_LEVEL("Trace");
+    testRateLimits();
+#ifndef WIN32
+    testMappedFile();
+#endif
+#ifndef WIN32
+    testTimestamps();
+#endif
+
+#ifdef SIMPLE_LOGGER_ASYNC
+    auto dir = Simple::fs::temp_directory_path() / "simple_logger_test";
+    Simple::fs::remove_all(dir);
+    LOG_TO_FILE(dir.string(), "async");
+    Simple::Logger::getInstance()->startAsync();
+    testThreads(dir);
+    assert(Simple::Logger::getInstance()->droppedLines() == 0);
+    testFlushUnderLoad(dir);
+    Simple::Logger::getInstance()->stopAsync();
+    LOG_INFO << "Written synchronously again";
+    Simple::fs::remove_all(dir);
+
+    LOG_TO_FILE(dir.string(), "buffered");
+    Simple::BufferedLogOptions options;
+    // small enough that threads flush on their own besides the periodic flushes
+    options.flushBytes = 4096;
+    Simple::Logger::getInstance()->startBuffered(options);
+    testThreads(dir);
+    Simple::Logger::getInstance()->stopBuffered();
+    LOG_INFO << "Written synchronously again";
+    Simple::fs::remove_all(dir);
+
+    testBufferedOrder(dir);
+    testRotation(dir);
+#ifndef WIN32
+    testSignalFlush(dir);
+#endif
+#endif
     return 0;
 }
@@ -0,0 +1,56 @@
+#include <atomic>
+#include <cassert>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+#include "Simple/Logger.hpp"
+#include "Simple/ParallelAlgorithms.hpp"
+
+int main()
+{
+    Simple::ThreadPool pool(4);
+
+    std::vector<size_t> values(100000);
+    Simple::parallelFor(pool, size_t{0}, values.size(), [&](size_t i) { values[i] = i; });
+    for (size_t i = 0; i < values.size(); ++i) {
+        assert(values[i] == i);
+    }
+
+    Simple::parallelFor(pool, values.begin(), values.end(), [](size_t& v) { v *= 2; });
+    assert(values[500] == 1000);
+
+    std::vector<double> halves(values.size());
+    auto end = Simple::parallelTransform(pool, values.begin(), values.end(), halves.begin(),
+                                         [](size_t v) { return v / 2.0; });
+    assert(end == halves.end());
+    assert(halves[500] == 500.0);
+
+    auto sum = Simple::parallelReduce(pool, values.begin(), values.end(), size_t{0}, std::plus<size_t>());
+    assert(sum == std::accumulate(values.begin(), values.end(), size_t{0}));
+    LOG_INFO << "Parallel sum: " << sum;
+
+    // nested calls from inside the pool must not deadlock
+    std::atomic_size_t nested{0};
+    Simple::parallelFor(pool, 0, 8, [&](int) {
+        Simple::parallelFor(pool, 0, 1000, [&](int) { ++nested; });
+    });
+    assert(nested == 8000);
+    LOG_INFO << "Nested iterations: " << nested;
+
+    try {
+        Simple::parallelFor(pool, 0, 1000, [](int i) {
+            if (i == 500)
+                throw std::runtime_error("iteration failed");
+        });
+        assert(false);
+    }
+    catch (const std::runtime_error& ex) {
+        LOG_INFO << "Exception from parallelFor: " << ex.what();
+    }
+
+    std::vector<int> empty;
+    assert(Simple::parallelReduce(pool, empty.begin(), empty.end(), 7, std::plus<int>()) == 7);
+
+    return 0;
+}
@@ -0,0 +1,142 @@
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Simple/Logger.hpp"
+#include "Simple/Pipeline.hpp"
+
+int main()
+{
+    // ordered stage restores input order after parallel stages
+    {
+        auto pipeline = Simple::Pipeline<int>{}
+                            .stage("square", 3, [](int value) { return value * value; })
+                            .stage("format", 4, [](int value) { return std::to_string(value); },
+                                Simple::StageOrder::Ordered);
+        pipeline.start();
+
+        const int count = 10000;
+        std::thread producer([&]() {
+            for (int i = 0; i < count; ++i) {
+                assert(pipeline.push(i));
+            }
+            pipeline.disable();
+        });
+
+        std::string result;
+        int expected = 0;
+        while (pipeline.get(result)) {
+            assert(result == std::to_string(expected * expected));
+            ++expected;
+        }
+        producer.join();
+        pipeline.wait();
+        assert(expected == count);
+        assert(!pipeline.push(1));
+
+        auto stats = pipeline.stats();
+        assert(stats.size() == 2);
+        assert(stats[0].name == "square" && stats[0].workers == 3 && stats[0].processed == count);
+        assert(stats[1].processed == count && stats[1].failed == 0);
+        LOG_INFO << "Ordered pipeline delivered " << expected << " results";
+    }
+
+    // ordered sink sees elements in order, failures are dropped and reported
+    {
+        std::vector<int> written;
+        auto pipeline = Simple::Pipeline<int>{}
+                            .stage("check", 4,
+                                [](int value) {
+                                    if (value % 100 == 0)
+                                        throw std::runtime_error("bad element");
+                                    return value;
+                                })
+                            .stage("write", 2, [&](int value) { written.push_back(value); }, Simple::StageOrder::Ordered);
+        pipeline.start();
+        for (int i = 1; i <= 1000; ++i) {
+            pipeline.push(i);
+        }
+
+        try {
+            pipeline.wait();
+            assert(false);
+        }
+        catch (const std::runtime_error& ex) {
+            LOG_INFO << "Pipeline failed: " << ex.what();
+        }
+        assert(written.size() == 990);
+        for (size_t i = 1; i < written.size(); ++i) {
+            assert(written[i - 1] < written[i]);
+        }
+        assert(pipeline.stats()[0].failed == 10);
+    }
+
+    // slow stage holds producers back and shows up as the bottleneck
+    {
+        std::atomic_int inFlight{0};
+        std::atomic_int maxInFlight{0};
+        auto pipeline = Simple::Pipeline<int, int, 4>{}
+                            .stage("fast", 2,
+                                [&](int value) {
+                                    int now = ++inFlight;
+                                    int seen = maxInFlight;
+                                    while (now > seen && !maxInFlight.compare_exchange_weak(seen, now)) {
+                                    }
+                                    return value;
+                                })
+                            .stage("slow", 1, [&](int) {
+                                std::this_thread::sleep_for(std::chrono::microseconds(200));
+                                --inFlight;
+                            });
+        pipeline.start();
+        for (int i = 0; i < 200; ++i) {
+            pipeline.push(i);
+        }
+        pipeline.wait();
+
+        // two buffers of 4, two fast workers and the slow one hold everything in flight
+        assert(maxInFlight <= 4 + 2 + 4 + 1);
+        auto stats = pipeline.stats();
+        for (auto& stage : stats) {
+            LOG_INFO << stage.name << ": " << stage.processed << " elements, " << static_cast<int>(stage.throughput())
+                     << "/s, utilization " << stage.utilization() << ", average queue " << stage.averageQueued
+                     << " of " << stage.capacity;
+        }
+        assert(stats[1].utilization() > stats[0].utilization());
+    }
+
+    // slow consumer behind an ordered stage holds its workers back instead of growing the parked results
+    {
+        std::vector<int> consumed;
+        auto pipeline = Simple::Pipeline<int, int, 4>{}
+                            .stage("uneven", 4,
+                                [](int value) {
+                                    // later elements often overtake earlier ones
+                                    std::this_thread::sleep_for(std::chrono::microseconds(value % 5 == 0 ? 300 : 10));
+                                    return value;
+                                },
+                                Simple::StageOrder::Ordered)
+                            .stage("slow", 1, [&](int value) {
+                                std::this_thread::sleep_for(std::chrono::microseconds(200));
+                                consumed.push_back(value);
+                            });
+        pipeline.start();
+        const int count = 500;
+        for (int i = 0; i < count; ++i) {
+            pipeline.push(i);
+        }
+        pipeline.wait();
+
+        assert(consumed.size() == count);
+        for (int i = 0; i < count; ++i) {
+            assert(consumed[i] == i);
+        }
+        auto stats = pipeline.stats();
+        LOG_INFO << "Ordered stage parked at most " << stats[0].reorderPeak << " results";
+        assert(stats[0].reorderPeak <= 4);
+    }
+}
@@ -0,0 +1,158 @@
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Simple/StructuredLogger.hpp"
+
+namespace {
+
+struct Point {
+    int x;
+    int y;
+};
+
+std::ostream& operator<<(std::ostream& os, const Point& point)
+{
+    return os << "(" << point.x << ", " << point.y << ")";
+}
+
+std::vector<std::string> readLines(const Simple::fs::path& dir)
+{
+    std::vector<std::string> lines;
+    for (auto& entry : Simple::fs::directory_iterator(dir)) {
+        std::ifstream file{entry.path().string()};
+        std::string line;
+        while (std::getline(file, line)) {
+            lines.push_back(line);
+        }
+    }
+    return lines;
+}
+
+// the part behind the time, which is the first field
+std::string fields(const std::string& line, const std::string& timeEnd)
+{
+    auto position = line.find(timeEnd);
+    assert(position != std::string::npos);
+    return line.substr(position + timeEnd.size());
+}
+
+void testJson(const Simple::fs::path& dir)
+{
+    LOG_TO_FILE(dir.string(), "json");
+    Simple::LogRecord::setFormat(Simple::LogRecordFormat::Json);
+
+    LOG_RECORD(Simple::LogLevel::Info, "plain");
+    {
+        Simple::LogContext service("service", "billing", "instance", 3);
+        LOG_RECORD(Simple::LogLevel::Warning, "numbers")
+            .field("int", -7)
+            .field("max", std::numeric_limits<uint64_t>::max())
+            .field("double", 0.1)
+            .field("infinity", std::numeric_limits<double>::infinity())
+            .field("flag", true);
+        {
+            Simple::LogContext request("request", std::string("r-42"));
+            LOG_RECORD(Simple::LogLevel::Error, "quote \" and \\ and\nnewline").field("point", Point{1, 2});
+        }
+        LOG_RECORD(Simple::LogLevel::Info, "request ended").field("char", 'x');
+    }
+    LOG_RECORD(Simple::LogLevel::Trace, "no context").field("control", std::string(1, '\x01'));
+    // filtered like LOG, the fields are not evaluated
+    LOG_REPORTING_LEVEL("Info");
+    int evaluated = 0;
+    LOG_RECORD(Simple::LogLevel::Debug, "hidden").field("evaluated", ++evaluated);
+    assert(evaluated == 0);
+    LOG_REPORTING_LEVEL("Trace");
+
+    auto lines = readLines(dir);
+    assert(lines.size() == 5);
+    for (auto& line : lines) {
+        assert(line.compare(0, 9, "{\"time\":\"") == 0 && line.back() == '}');
+    }
+    assert(fields(lines[0], "\",") == R"("level":"INFO","msg":"plain"})");
+    assert(fields(lines[1], "\",") == R"("level":"WARNING","msg":"numbers","service":"billing","instance":3,"int":-7,)"
+                                      R"("max":18446744073709551615,"double":0.1,"infinity":"inf","flag":true})");
+    assert(fields(lines[2], "\",") == R"("level":"ERROR","msg":"quote \" and \\ and\nnewline","service":"billing",)"
+                                      R"x("instance":3,"request":"r-42","point":"(1, 2)"})x");
+    assert(fields(lines[3], "\",") == R"("level":"INFO","msg":"request ended","service":"billing","instance":3,)"
+                                      R"("char":"x"})");
+    assert(fields(lines[4], "\",") == R"("level":"TRACE","msg":"no context","control":"\u0001"})");
+}
+
+void testLogfmt(const Simple::fs::path& dir)
+{
+    LOG_TO_FILE(dir.string(), "logfmt");
+    Simple::LogRecord::setFormat(Simple::LogRecordFormat::Logfmt);
+
+    {
+        Simple::LogContext service("service", "billing", "region", "eu west");
+        LOG_RECORD(Simple::LogLevel::Info, "charged").field("amount", 12.5).field("currency", "EUR");
+        LOG_RECORD(Simple::LogLevel::Debug, "key=value").field("empty", "").field("quote", "say \"hi\"");
+    }
+
+    auto lines = readLines(dir);
+    assert(lines.size() == 2);
+    for (auto& line : lines) {
+        assert(line.compare(0, 6, "time=\"") == 0);
+    }
+    assert(fields(lines[0], "\" ")
+           == R"(level=INFO msg=charged service=billing region="eu west" amount=12.5 currency=EUR)");
+    assert(fields(lines[1], "\" ")
+           == R"(level=DEBUG msg="key=value" service=billing region="eu west" empty="" quote="say \"hi\"")");
+}
+
+// every thread sees only the contexts of its own scopes
+void testThreads(const Simple::fs::path& dir)
+{
+    LOG_TO_FILE(dir.string(), "threads");
+    Simple::LogRecord::setFormat(Simple::LogRecordFormat::Logfmt);
+
+    const int threadCount = 4;
+    const int lineCount = 1000;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < threadCount; ++t) {
+        threads.push_back(std::thread([t]() {
+            Simple::LogContext thread("thread", t);
+            for (int i = 0; i < lineCount; ++i) {
+                Simple::LogContext line("line", i);
+                LOG_RECORD(Simple::LogLevel::Info, "line");
+            }
+        }));
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    auto lines = readLines(dir);
+    assert(lines.size() == threadCount * lineCount);
+    std::vector<int> next(threadCount, 0);
+    for (auto& line : lines) {
+        int t = 0;
+        int i = 0;
+        assert(sscanf(fields(line, "msg=line ").c_str(), "thread=%d line=%d", &t, &i) == 2);
+        assert(fields(line, "msg=line ") == "thread=" + std::to_string(t) + " line=" + std::to_string(i));
+        assert(next[t] == i);
+        ++next[t];
+    }
+}
+} // namespace
+
+int main()
+{
+    LOG_REPORTING_LEVEL("Trace");
+    auto dir = Simple::fs::temp_directory_path() / "simple_structured_logger_test";
+    Simple::fs::remove_all(dir);
+
+    testJson(dir / "json");
+    testLogfmt(dir / "logfmt");
+    testThreads(dir / "threads");
+
+    Simple::fs::remove_all(dir);
+    return 0;
+}
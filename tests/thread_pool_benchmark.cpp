@@ -0,0 +1,495 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Simple/ParallelAlgorithms.hpp"
+#include "Simple/ThreadPool.hpp"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+static std::atomic_size_t allocationCount{0};
+
+void* operator new(size_t size)
+{
+    ++allocationCount;
+    if (void* p = std::malloc(size))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    std::free(p);
+}
+
+namespace {
+
+using ClockType = std::chrono::steady_clock;
+
+const size_t TaskCount = 200000;
+const size_t ChildrenPerRoot = 100;
+
+void work()
+{
+    volatile size_t s = 0;
+    for (size_t i = 0; i < 100; ++i) {
+        s = s + i;
+    }
+}
+
+void waitFor(std::atomic_size_t& done, size_t expected)
+{
+    while (done.load() < expected) {
+        std::this_thread::yield();
+    }
+}
+
+// every task is submitted from the main thread
+double flat(size_t threads, Simple::Scheduling scheduling)
+{
+    std::atomic_size_t done{0};
+    auto begin = ClockType::now();
+    {
+        Simple::ThreadPool pool(threads, scheduling);
+        for (size_t i = 0; i < TaskCount; ++i) {
+            pool.addTask([&done]() {
+                work();
+                ++done;
+            });
+        }
+        waitFor(done, TaskCount);
+    }
+    std::chrono::duration<double> elapsed = ClockType::now() - begin;
+    return TaskCount / elapsed.count();
+}
+
+// root tasks fan out into children submitted from inside the workers
+double nested(size_t threads, Simple::Scheduling scheduling)
+{
+    const size_t roots = TaskCount / ChildrenPerRoot;
+    std::atomic_size_t done{0};
+    auto begin = ClockType::now();
+    {
+        Simple::ThreadPool pool(threads, scheduling);
+        for (size_t i = 0; i < roots; ++i) {
+            pool.addTask([&pool, &done]() {
+                for (size_t c = 0; c < ChildrenPerRoot; ++c) {
+                    pool.addTask([&done]() {
+                        work();
+                        ++done;
+                    });
+                }
+            });
+        }
+        waitFor(done, roots * ChildrenPerRoot);
+    }
+    std::chrono::duration<double> elapsed = ClockType::now() - begin;
+    return TaskCount / elapsed.count();
+}
+
+struct SubmissionCost {
+    double tasksPerSecond;
+    double allocationsPerTask;
+};
+
+// second run on the same pool, queues and allocator caches are already warm
+SubmissionCost submissionCost(size_t threads, Simple::Scheduling scheduling, bool withFuture)
+{
+    Simple::ThreadPool pool(threads, scheduling);
+    std::vector<std::future<void>> futures;
+    futures.reserve(TaskCount);
+    std::atomic_size_t done{0};
+
+    auto runOnce = [&]() {
+        done = 0;
+        futures.clear();
+        for (size_t i = 0; i < TaskCount; ++i) {
+            auto task = [&done]() {
+                work();
+                ++done;
+            };
+            if (withFuture)
+                futures.push_back(pool.addTask(task));
+            else
+                pool.post(task);
+        }
+        for (auto& f : futures) {
+            f.get();
+        }
+        waitFor(done, TaskCount);
+    };
+
+    runOnce();
+    size_t allocationsBefore = allocationCount;
+    auto begin = ClockType::now();
+    runOnce();
+    std::chrono::duration<double> elapsed = ClockType::now() - begin;
+    return {TaskCount / elapsed.count(), static_cast<double>(allocationCount - allocationsBefore) / TaskCount};
+}
+
+// one future per element against one parallelFor over the whole batch
+void reportBatch()
+{
+    Simple::ThreadPool pool(std::max<unsigned>(std::thread::hardware_concurrency(), 1));
+    std::vector<double> values(TaskCount, 1.0);
+
+    auto begin = ClockType::now();
+    std::vector<std::future<void>> futures;
+    futures.reserve(values.size());
+    for (auto& v : values) {
+        futures.push_back(pool.addTask([&v]() { v = v * 1.5 + 1.0; }));
+    }
+    for (auto& f : futures) {
+        f.get();
+    }
+    std::chrono::duration<double> perElement = ClockType::now() - begin;
+
+    begin = ClockType::now();
+    Simple::parallelFor(pool, values.begin(), values.end(), [](double& v) { v = v * 1.5 + 1.0; });
+    std::chrono::duration<double> batched = ClockType::now() - begin;
+
+    std::cout << "Batch of " << values.size() << " elements" << std::endl;
+    std::cout << std::setw(26) << "addTask per element" << std::setw(12) << perElement.count() * 1000 << " ms"
+              << std::endl;
+    std::cout << std::setw(26) << "parallelFor" << std::setw(12) << batched.count() * 1000 << " ms" << std::endl;
+}
+
+// latency of interactive tasks submitted while the pool is saturated with batch work
+std::vector<double> interactiveLatency(bool prioritized)
+{
+    const size_t batchTasks = TaskCount;
+    const size_t probes = 200;
+
+    Simple::ThreadPool pool(std::max<unsigned>(std::thread::hardware_concurrency(), 1));
+    std::atomic_size_t done{0};
+    for (size_t i = 0; i < batchTasks; ++i) {
+        auto batch = [&done]() {
+            work();
+            ++done;
+        };
+        if (prioritized)
+            pool.post(Simple::TaskPriority::Low, batch);
+        else
+            pool.post(batch);
+    }
+
+    std::vector<std::future<double>> futures;
+    for (size_t i = 0; i < probes; ++i) {
+        auto submitted = ClockType::now();
+        auto probe = [submitted]() {
+            std::chrono::duration<double, std::milli> waited = ClockType::now() - submitted;
+            return waited.count();
+        };
+        if (prioritized)
+            futures.push_back(pool.addTask(Simple::TaskPriority::High, probe));
+        else
+            futures.push_back(pool.addTask(probe));
+        std::this_thread::sleep_for(std::chrono::microseconds{100});
+    }
+
+    std::vector<double> latencies;
+    for (auto& f : futures) {
+        latencies.push_back(f.get());
+    }
+    waitFor(done, batchTasks);
+    std::sort(latencies.begin(), latencies.end());
+    return latencies;
+}
+
+void reportPriorityLatency()
+{
+    auto percentile = [](const std::vector<double>& sorted, double p) {
+        return sorted[static_cast<size_t>(p * (sorted.size() - 1))];
+    };
+    auto fifo = interactiveLatency(false);
+    auto high = interactiveLatency(true);
+
+    std::cout << "Interactive task latency under batch load" << std::endl;
+    std::cout << std::setw(26) << "" << std::setw(12) << "p50 ms" << std::setw(12) << "p99 ms" << std::endl;
+    std::cout << std::setw(26) << "same class as batch" << std::setw(12) << percentile(fifo, 0.5) << std::setw(12)
+              << percentile(fifo, 0.99) << std::endl;
+    std::cout << std::setw(26) << "High over Low batch" << std::setw(12) << percentile(high, 0.5) << std::setw(12)
+              << percentile(high, 0.99) << std::endl;
+}
+
+// last level cache misses of this process and all threads it starts afterwards
+class CacheMissCounter {
+public:
+    CacheMissCounter()
+    {
+#ifdef __linux__
+        perf_event_attr attr{};
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = PERF_COUNT_HW_CACHE_MISSES;
+        attr.disabled = 1;
+        attr.inherit = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+        if (fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif
+    }
+
+    ~CacheMissCounter()
+    {
+#ifdef __linux__
+        if (fd >= 0)
+            close(fd);
+#endif
+    }
+
+    // -1 when hardware counters are not available
+    long long stop()
+    {
+        long long count = -1;
+#ifdef __linux__
+        if (fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+            if (read(fd, &count, sizeof(count)) != sizeof(count))
+                count = -1;
+        }
+#endif
+        return count;
+    }
+
+private:
+    int fd = -1;
+};
+
+struct PlacementResult {
+    double tasksPerSecond;
+    long long cacheMisses;
+};
+
+// every root fills a block which its children read, local execution keeps the block in cache
+PlacementResult placementRun(Simple::Placement placement)
+{
+    const size_t roots = TaskCount / ChildrenPerRoot;
+    const size_t blockSize = 2048;
+
+    Simple::ThreadPoolOptions options;
+    options.minThreads = options.maxThreads = std::max<unsigned>(std::thread::hardware_concurrency(), 1);
+    options.scheduling = Simple::Scheduling::WorkStealing;
+    options.placement = placement;
+
+    std::atomic_size_t done{0};
+    CacheMissCounter counter;
+    auto begin = ClockType::now();
+    {
+        Simple::ThreadPool pool(options);
+        for (size_t i = 0; i < roots; ++i) {
+            pool.post([&pool, &done, blockSize]() {
+                auto block = std::make_shared<std::vector<size_t>>(blockSize, 1);
+                for (size_t c = 0; c < ChildrenPerRoot; ++c) {
+                    pool.post([block, &done]() {
+                        volatile size_t sum = 0;
+                        for (auto v : *block) {
+                            sum = sum + v;
+                        }
+                        ++done;
+                    });
+                }
+            });
+        }
+        waitFor(done, roots * ChildrenPerRoot);
+    }
+    std::chrono::duration<double> elapsed = ClockType::now() - begin;
+    return {TaskCount / elapsed.count(), counter.stop()};
+}
+
+void reportPlacement()
+{
+    std::cout << "Worker placement, work stealing with " << TaskCount << " cache bound tasks" << std::endl;
+    std::cout << std::setw(10) << "placement" << std::setw(16) << "tasks/s" << std::setw(16) << "LLC misses"
+              << std::endl;
+    for (auto placement : {Simple::Placement::None, Simple::Placement::Pack, Simple::Placement::Spread}) {
+        auto result = placementRun(placement);
+        const char* name = placement == Simple::Placement::None ? "none"
+                           : placement == Simple::Placement::Pack ? "pack"
+                                                                  : "spread";
+        std::cout << std::setw(10) << name << std::setw(16) << static_cast<size_t>(result.tasksPerSecond);
+        if (result.cacheMisses < 0)
+            std::cout << std::setw(16) << "n/a" << std::endl;
+        else
+            std::cout << std::setw(16) << result.cacheMisses << std::endl;
+    }
+}
+
+// posted tasks per second with and without counters and histograms
+double instrumentedRun(bool instrumentation)
+{
+    Simple::ThreadPoolOptions options;
+    options.minThreads = options.maxThreads = std::max<unsigned>(std::thread::hardware_concurrency(), 1);
+    options.instrumentation = instrumentation;
+
+    std::atomic_size_t done{0};
+    auto begin = ClockType::now();
+    {
+        Simple::ThreadPool pool(options);
+        for (size_t i = 0; i < TaskCount; ++i) {
+            pool.post([&done]() {
+                work();
+                ++done;
+            });
+        }
+        waitFor(done, TaskCount);
+    }
+    std::chrono::duration<double> elapsed = ClockType::now() - begin;
+    return TaskCount / elapsed.count();
+}
+
+void reportInstrumentationCost()
+{
+    auto plain = instrumentedRun(false);
+    auto instrumented = instrumentedRun(true);
+    std::cout << "Instrumentation cost (" << TaskCount << " posted tasks)" << std::endl;
+    std::cout << std::setw(26) << "disabled" << std::setw(12) << static_cast<size_t>(plain) << " tasks/s" << std::endl;
+    std::cout << std::setw(26) << "enabled" << std::setw(12) << static_cast<size_t>(instrumented) << " tasks/s"
+              << std::endl;
+    std::cout << std::setw(26) << "overhead" << std::setw(12) << (1e9 / instrumented - 1e9 / plain) << " ns/task"
+              << std::endl;
+}
+
+// user and system time of the whole process in seconds
+double cpuTime()
+{
+#ifdef __linux__
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+#else
+    return 0.0;
+#endif
+}
+
+struct IdleResult {
+    Simple::LatencyHistogram startLatency;
+    // CPU seconds burnt per wall clock second
+    double cpuLoad;
+};
+
+// sporadic tasks, workers are idle between them
+IdleResult idleRun(Simple::IdlePolicy policy)
+{
+    const size_t tasks = 2000;
+
+    Simple::ThreadPoolOptions options;
+    options.minThreads = options.maxThreads = std::max<unsigned>(std::thread::hardware_concurrency(), 1);
+    options.idlePolicy = policy;
+    options.spinDuration = std::chrono::microseconds{200};
+    Simple::ThreadPool pool(options);
+
+    std::vector<std::chrono::nanoseconds> latencies(tasks);
+    std::atomic_size_t done{0};
+    double cpuBefore = cpuTime();
+    auto begin = ClockType::now();
+    for (size_t i = 0; i < tasks; ++i) {
+        auto submitted = ClockType::now();
+        pool.post([&latencies, &done, submitted, i]() {
+            latencies[i] = ClockType::now() - submitted;
+            ++done;
+        });
+        std::this_thread::sleep_for(std::chrono::microseconds{100});
+    }
+    waitFor(done, tasks);
+    std::chrono::duration<double> wall = ClockType::now() - begin;
+
+    IdleResult result;
+    result.cpuLoad = (cpuTime() - cpuBefore) / wall.count();
+    for (auto latency : latencies) {
+        result.startLatency.record(latency);
+    }
+    return result;
+}
+
+void reportIdlePolicies()
+{
+    std::cout << "Idle policy, submit to start latency of sporadic tasks" << std::endl;
+    std::cout << std::setw(10) << "policy" << std::setw(12) << "p50 us" << std::setw(12) << "p99 us" << std::setw(12)
+              << "CPU load" << std::endl;
+    for (auto policy : {Simple::IdlePolicy::Park, Simple::IdlePolicy::Spin, Simple::IdlePolicy::Yield}) {
+        auto result = idleRun(policy);
+        const char* name = policy == Simple::IdlePolicy::Park ? "park"
+                           : policy == Simple::IdlePolicy::Spin ? "spin"
+                                                                : "yield";
+        std::cout << std::setw(10) << name << std::setw(12) << result.startLatency.percentile(0.5) / 1000.0
+                  << std::setw(12) << result.startLatency.percentile(0.99) / 1000.0 << std::setw(12)
+                  << result.cpuLoad << std::endl;
+    }
+}
+
+std::vector<size_t> threadCounts()
+{
+    size_t maxThreads = std::max<unsigned>(std::thread::hardware_concurrency(), 1);
+    std::vector<size_t> counts;
+    for (size_t threads = 1; threads < maxThreads; threads *= 2) {
+        counts.push_back(threads);
+    }
+    counts.push_back(maxThreads);
+    return counts;
+}
+
+void report(const std::string& name, double (*benchmark)(size_t, Simple::Scheduling))
+{
+    std::cout << name << " submission, tasks per second (" << TaskCount << " tasks per run)" << std::endl;
+    std::cout << std::setw(10) << "threads" << std::setw(16) << "global" << std::setw(16) << "stealing"
+              << std::endl;
+    for (auto threads : threadCounts()) {
+        auto global = benchmark(threads, Simple::Scheduling::GlobalQueue);
+        auto stealing = benchmark(threads, Simple::Scheduling::WorkStealing);
+        std::cout << std::setw(10) << threads << std::setw(16) << static_cast<size_t>(global) << std::setw(16)
+                  << static_cast<size_t>(stealing) << std::endl;
+    }
+}
+
+void reportSubmissionCost(const std::string& name, Simple::Scheduling scheduling)
+{
+    std::cout << name << " submission cost (" << TaskCount << " tasks per run)" << std::endl;
+    std::cout << std::setw(10) << "threads" << std::setw(16) << "addTask/s" << std::setw(16) << "allocs/task"
+              << std::setw(16) << "post/s" << std::setw(16) << "allocs/task" << std::endl;
+    for (auto threads : threadCounts()) {
+        auto withFuture = submissionCost(threads, scheduling, true);
+        auto posted = submissionCost(threads, scheduling, false);
+        std::cout << std::setw(10) << threads << std::setw(16) << static_cast<size_t>(withFuture.tasksPerSecond)
+                  << std::setw(16) << withFuture.allocationsPerTask << std::setw(16)
+                  << static_cast<size_t>(posted.tasksPerSecond) << std::setw(16) << posted.allocationsPerTask
+                  << std::endl;
+    }
+}
+} // namespace
+
+int main()
+{
+    report("External", flat);
+    report("Nested", nested);
+    reportSubmissionCost("Global queue", Simple::Scheduling::GlobalQueue);
+    reportSubmissionCost("Work stealing", Simple::Scheduling::WorkStealing);
+    reportBatch();
+    reportPriorityLatency();
+    reportPlacement();
+    reportInstrumentationCost();
+    reportIdlePolicies();
+    return 0;
+}
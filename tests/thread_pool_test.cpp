@@ -1,4 +1,9 @@
+#include <atomic>
+#include <cassert>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
 #include <thread>
 
 #include "Simple/Logger.hpp"
@@ -50,5 +55,183 @@ int main()
         LOG_INFO << "REsult: " << s;
     }
 
+    Simple::ThreadPool stealingPool(4, Simple::Scheduling::WorkStealing);
+
+    std::atomic_size_t children{0};
+    std::vector<std::future<void>> futures3;
+    for (size_t i = 0; i < 100; ++i) {
+        futures3.push_back(stealingPool.addTask([&]() {
+            // nested tasks go to the worker's own deque and get stolen by idle workers
+            for (size_t c = 0; c < 10; ++c) {
+                stealingPool.addTask([&]() { ++children; });
+            }
+        }));
+    }
+
+    for (auto& f : futures3) {
+        f.get();
+    }
+    while (children < 1000) {
+        std::this_thread::yield();
+    }
+    LOG_INFO << "Work stealing children: " << children;
+
+    Simple::ThreadPoolOptions options;
+    options.minThreads = 1;
+    options.maxThreads = 4;
+    options.idleTimeout = std::chrono::milliseconds{50};
+    Simple::ThreadPool adaptivePool(options);
+
+    std::vector<std::future<void>> futures4;
+    for (size_t i = 0; i < 1000; ++i) {
+        futures4.push_back(
+            adaptivePool.addTask([]() { std::this_thread::sleep_for(std::chrono::microseconds{100}); }));
+    }
+    LOG_INFO << "Adaptive pool workers under load: " << adaptivePool.size();
+    assert(adaptivePool.size() <= 4);
+
+    for (auto& f : futures4) {
+        f.get();
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds{500});
+    LOG_INFO << "Adaptive pool workers after idle timeout: " << adaptivePool.size();
+    assert(adaptivePool.size() == 1);
+
+    // move-only captures and fire-and-forget tasks
+    std::atomic_size_t posted{0};
+    auto owned = std::make_unique<size_t>(42);
+    auto ownedResult = adaptivePool.addTask([owned = std::move(owned)]() { return *owned; });
+    for (size_t i = 0; i < 100; ++i) {
+        adaptivePool.post([&posted](size_t value) { posted += value; }, 1);
+    }
+    assert(ownedResult.get() == 42);
+
+    auto failing = adaptivePool.addTask([]() -> int { throw std::runtime_error("task failed"); });
+    try {
+        failing.get();
+        assert(false);
+    }
+    catch (const std::runtime_error& ex) {
+        LOG_INFO << "Exception from task: " << ex.what();
+    }
+
+    while (posted < 100) {
+        std::this_thread::yield();
+    }
+    LOG_INFO << "Posted tasks: " << posted;
+
+    // single worker is blocked, so queued tasks are picked in priority order afterwards
+    for (auto scheduling : {Simple::Scheduling::GlobalQueue, Simple::Scheduling::WorkStealing}) {
+        Simple::ThreadPoolOptions priorityOptions;
+        priorityOptions.minThreads = 1;
+        priorityOptions.maxThreads = 1;
+        priorityOptions.scheduling = scheduling;
+        // steep weights make the round robin strict for a handful of tasks
+        priorityOptions.priorityWeights = {{100, 10, 1}};
+        Simple::ThreadPool priorityPool(priorityOptions);
+
+        std::promise<void> gate;
+        std::promise<void> blocked;
+        std::shared_future<void> opened = gate.get_future().share();
+        priorityPool.post([opened, &blocked]() {
+            blocked.set_value();
+            opened.wait();
+        });
+        blocked.get_future().wait();
+
+        std::mutex orderMtx;
+        std::vector<int> order;
+        auto record = [&](int id) {
+            std::lock_guard<std::mutex> lock{orderMtx};
+            order.push_back(id);
+        };
+        auto now = Simple::ThreadPool::Clock::now();
+        auto low = priorityPool.addTask(Simple::TaskPriority::Low, record, 4);
+        auto normal = priorityPool.addTask(record, 3);
+        auto late = priorityPool.addTask(now + std::chrono::seconds{2}, record, 2);
+        auto early = priorityPool.addTask(now + std::chrono::seconds{1}, record, 1);
+        assert(priorityPool.queueDepth(Simple::TaskPriority::High) == 2);
+        assert(priorityPool.queueDepth(Simple::TaskPriority::Normal) == 1);
+        assert(priorityPool.queueDepth(Simple::TaskPriority::Low) == 1);
+
+        gate.set_value();
+        low.get();
+        normal.get();
+        late.get();
+        early.get();
+        assert((order == std::vector<int>{1, 2, 3, 4}));
+        assert(priorityPool.queueDepth(Simple::TaskPriority::High) == 0);
+        LOG_INFO << "Priority order verified";
+    }
+
+    assert((Simple::NumaTopology::parseCpuList("0-2,5,7-8\n") == std::vector<unsigned>{0, 1, 2, 5, 7, 8}));
+    auto allowed = Simple::NumaTopology::allowedCpus();
+    auto order = Simple::NumaTopology::instance().placementOrder(Simple::Placement::Spread, {allowed.front()});
+    assert((order == std::vector<unsigned>{allowed.front()}));
+
+    Simple::ThreadPoolOptions pinnedOptions;
+    pinnedOptions.minThreads = pinnedOptions.maxThreads = 2;
+    pinnedOptions.scheduling = Simple::Scheduling::WorkStealing;
+    pinnedOptions.placement = Simple::Placement::Pack;
+    Simple::ThreadPool pinnedPool(pinnedOptions);
+    auto cpu = pinnedPool.addTask([]() { return sched_getcpu(); }).get();
+    LOG_INFO << "Pinned worker runs on CPU " << cpu << " of node "
+             << Simple::NumaTopology::instance().nodeOf(static_cast<unsigned>(cpu));
+
+    Simple::LatencyHistogram histogram;
+    for (uint64_t v = 1; v <= 1000; ++v) {
+        histogram.record(v * 1000);
+    }
+    assert(histogram.count() == 1000);
+    assert(histogram.max() == 1000000);
+    // buckets are at most 1/16 wide relative to their values
+    assert(histogram.percentile(0.5) >= 500000 && histogram.percentile(0.5) <= 500000 * 17 / 16);
+    assert(histogram.percentile(1.0) == 1000000);
+
+    Simple::ThreadPoolOptions instrumentedOptions;
+    instrumentedOptions.minThreads = instrumentedOptions.maxThreads = 2;
+    instrumentedOptions.instrumentation = true;
+    Simple::ThreadPool instrumentedPool(instrumentedOptions);
+    std::vector<std::future<void>> timed;
+    for (size_t i = 0; i < 20; ++i) {
+        timed.push_back(instrumentedPool.addTask([]() { std::this_thread::sleep_for(std::chrono::milliseconds{1}); }));
+    }
+    for (auto& f : timed) {
+        f.get();
+    }
+    // counters are updated right after the task returned, possibly after its future got ready
+    auto stats = instrumentedPool.stats();
+    while (stats.tasks() < 20) {
+        std::this_thread::yield();
+        stats = instrumentedPool.stats();
+    }
+    assert(stats.tasks() == 20);
+    assert(stats.runTime.count() == 20 && stats.queueTime.count() == 20);
+    assert(stats.runTime.percentile(0.5) >= 1000000);
+    assert(stats.utilization() > 0.0 && stats.utilization() <= 1.0);
+    LOG_INFO << "Instrumented pool: p50 run " << stats.runTime.percentile(0.5) << " ns, p99 queue "
+             << stats.queueTime.percentile(0.99) << " ns, utilization " << stats.utilization();
+
+    for (auto policy : {Simple::IdlePolicy::Spin, Simple::IdlePolicy::Yield}) {
+        for (auto scheduling : {Simple::Scheduling::GlobalQueue, Simple::Scheduling::WorkStealing}) {
+            Simple::ThreadPoolOptions spinOptions;
+            spinOptions.minThreads = spinOptions.maxThreads = 3;
+            spinOptions.scheduling = scheduling;
+            spinOptions.idlePolicy = policy;
+            Simple::ThreadPool spinPool(spinOptions);
+
+            std::atomic_size_t ran{0};
+            for (size_t i = 0; i < 1000; ++i) {
+                spinPool.post([&ran]() { ++ran; });
+                if (i % 100 == 0)
+                    std::this_thread::sleep_for(std::chrono::microseconds{200});
+            }
+            while (ran < 1000) {
+                std::this_thread::yield();
+            }
+        }
+    }
+    LOG_INFO << "Spinning idle policies verified";
+
     return 0;
 }